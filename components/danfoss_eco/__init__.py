@@ -0,0 +1,87 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome import automation
+from esphome.components import climate, ble_client, esp32_ble_tracker
+from esphome.const import CONF_ID, CONF_MODE, CONF_TARGET_TEMPERATURE, CONF_TRIGGER_ID
+
+CODEOWNERS = ["@dmitry-cherkas"]
+
+CONF_DANFOSS_ECO_ID = 'danfoss_eco_id'
+CONF_MAX_CONNECTIONS = 'max_connections'
+CONF_CONNECTION_TIMEOUT = 'connection_timeout'
+CONF_ADVERTISEMENT_TIMEOUT = 'advertisement_timeout'
+CONF_GROUP_CONCURRENCY = 'group_concurrency'
+CONF_GROUP_TIMEOUT = 'group_timeout'
+CONF_ON_GROUP_RESULT = 'on_group_result'
+CONF_ON_GROUP_COMPLETE = 'on_group_complete'
+CONF_DEVICES = 'devices'
+
+eco_ns = cg.esphome_ns.namespace("danfoss_eco")
+ConnectionScheduler = eco_ns.class_("ConnectionScheduler", cg.Component)
+DanfossEco = eco_ns.class_(
+    "Device", climate.Climate, ble_client.BLEClientNode, cg.PollingComponent, esp32_ble_tracker.ESPBTDeviceListener
+)
+
+GroupControlAction = eco_ns.class_("GroupControlAction", automation.Action, cg.Parented.template(ConnectionScheduler))
+GroupResultTrigger = eco_ns.class_("GroupResultTrigger", automation.Trigger.template(cg.std_string, cg.bool_))
+GroupCompleteTrigger = eco_ns.class_("GroupCompleteTrigger", automation.Trigger.template(cg.uint32, cg.int_, cg.int_))
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(ConnectionScheduler),
+        cv.Optional(CONF_MAX_CONNECTIONS, default=2): cv.int_range(min=1, max=9),
+        cv.Optional(CONF_CONNECTION_TIMEOUT, default="30s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_ADVERTISEMENT_TIMEOUT, default="5min"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_GROUP_CONCURRENCY, default=2): cv.int_range(min=1, max=9),
+        cv.Optional(CONF_GROUP_TIMEOUT, default="60s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_ON_GROUP_RESULT): automation.validate_automation({
+            cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(GroupResultTrigger),
+        }),
+        cv.Optional(CONF_ON_GROUP_COMPLETE): automation.validate_automation({
+            cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(GroupCompleteTrigger),
+        }),
+    }
+).extend(cv.COMPONENT_SCHEMA)
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+    cg.add_define("USE_DANFOSS_ECO")
+
+    cg.add(var.set_max_connections(config[CONF_MAX_CONNECTIONS]))
+    cg.add(var.set_connection_timeout(config[CONF_CONNECTION_TIMEOUT]))
+    cg.add(var.set_advertisement_timeout(config[CONF_ADVERTISEMENT_TIMEOUT]))
+    cg.add(var.set_group_concurrency(config[CONF_GROUP_CONCURRENCY]))
+    cg.add(var.set_group_timeout(config[CONF_GROUP_TIMEOUT]))
+
+    for conf in config.get(CONF_ON_GROUP_RESULT, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(cg.std_string, "name"), (bool, "success")], conf)
+    for conf in config.get(CONF_ON_GROUP_COMPLETE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(cg.uint32, "duration"), (int, "succeeded"), (int, "failed")], conf)
+
+GROUP_CONTROL_ACTION_SCHEMA = cv.All(
+    cv.Schema({
+        cv.GenerateID(): cv.use_id(ConnectionScheduler),
+        cv.Optional(CONF_DEVICES): cv.ensure_list(cv.use_id(DanfossEco)),
+        cv.Optional(CONF_TARGET_TEMPERATURE): cv.templatable(cv.temperature),
+        cv.Optional(CONF_MODE): cv.templatable(climate.validate_climate_mode),
+    }),
+    cv.has_at_least_one_key(CONF_TARGET_TEMPERATURE, CONF_MODE)
+)
+
+@automation.register_action("danfoss_eco.group_control", GroupControlAction, GROUP_CONTROL_ACTION_SCHEMA)
+async def group_control_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    for device_id in config.get(CONF_DEVICES, []):
+        device = await cg.get_variable(device_id)
+        cg.add(var.add_device(device))
+    if CONF_TARGET_TEMPERATURE in config:
+        template_ = await cg.templatable(config[CONF_TARGET_TEMPERATURE], args, float)
+        cg.add(var.set_target_temperature(template_))
+    if CONF_MODE in config:
+        template_ = await cg.templatable(config[CONF_MODE], args, climate.ClimateMode)
+        cg.add(var.set_mode(template_))
+    return var
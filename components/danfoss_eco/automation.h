@@ -0,0 +1,63 @@
+#pragma once
+
+#include "esphome/core/automation.h"
+#include "esphome/core/helpers.h"
+
+#include "scheduler.h"
+
+#ifdef USE_ESP32
+
+namespace esphome
+{
+    namespace danfoss_eco
+    {
+        // applies the setpoint and/or mode to the listed eTRVs (all of them, if none are listed)
+        template <typename... Ts>
+        class GroupControlAction : public Action<Ts...>, public Parented<ConnectionScheduler>
+        {
+        public:
+            TEMPLATABLE_VALUE(float, target_temperature)
+            TEMPLATABLE_VALUE(climate::ClimateMode, mode)
+
+            void add_device(Device *device) { this->devices_.push_back(device); }
+
+            void play(Ts... x) override
+            {
+                GroupCommand command;
+                if (this->target_temperature_.has_value())
+                    command.target_temperature = this->target_temperature_.value(x...);
+                if (this->mode_.has_value())
+                    command.mode = this->mode_.value(x...);
+                this->parent_->start_group(this->devices_, command);
+            }
+
+        protected:
+            vector<Device *> devices_;
+        };
+
+        // fired for every device of the group operation, once its writes are acknowledged (or have failed)
+        class GroupResultTrigger : public Trigger<std::string, bool>
+        {
+        public:
+            explicit GroupResultTrigger(ConnectionScheduler *parent)
+            {
+                parent->add_on_group_result_callback([this](std::string name, bool success)
+                                                     { this->trigger(name, success); });
+            }
+        };
+
+        // fired once all the devices of the group operation are done: duration (ms), succeeded and failed devices
+        class GroupCompleteTrigger : public Trigger<uint32_t, int, int>
+        {
+        public:
+            explicit GroupCompleteTrigger(ConnectionScheduler *parent)
+            {
+                parent->add_on_group_complete_callback([this](uint32_t duration, int succeeded, int failed)
+                                                       { this->trigger(duration, succeeded, failed); });
+            }
+        };
+
+    } // namespace danfoss_eco
+} // namespace esphome
+
+#endif // USE_ESP32
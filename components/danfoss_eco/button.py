@@ -0,0 +1,24 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import button
+from esphome.const import ENTITY_CATEGORY_DIAGNOSTIC
+
+from . import eco_ns, ConnectionScheduler, CONF_DANFOSS_ECO_ID
+
+DEPENDENCIES = ["danfoss_eco"]
+
+DumpTraceButton = eco_ns.class_("DumpTraceButton", button.Button, cg.Parented.template(ConnectionScheduler))
+
+CONFIG_SCHEMA = button.button_schema(
+    DumpTraceButton,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    icon="mdi:text-box-search-outline"
+).extend(
+    {
+        cv.GenerateID(CONF_DANFOSS_ECO_ID): cv.use_id(ConnectionScheduler),
+    }
+)
+
+async def to_code(config):
+    var = await button.new_button(config)
+    await cg.register_parented(var, config[CONF_DANFOSS_ECO_ID])
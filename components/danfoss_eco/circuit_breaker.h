@@ -0,0 +1,101 @@
+#pragma once
+
+#include "esphome/core/helpers.h"
+
+#include <algorithm>
+
+namespace esphome
+{
+    namespace danfoss_eco
+    {
+        enum class BreakerState : uint8_t
+        {
+            CLOSED,   // connections are attempted, failed ones are retried with exponential backoff
+            OPEN,     // too many consecutive failures, no connections till the open period is over
+            HALF_OPEN // a single probe connection is allowed, its result either closes or re-opens the breaker
+        };
+
+        // Per-device protection from wasting airtime on a device, which does not respond (i.e. dead battery or wrong PIN).
+        class CircuitBreaker
+        {
+        public:
+            void set_failure_threshold(uint8_t threshold) { this->failure_threshold_ = threshold; }
+            void set_backoff(uint32_t initial, uint32_t max)
+            {
+                this->initial_backoff_ = initial;
+                this->max_backoff_ = max;
+            }
+
+            // returns true, if the connection attempt is allowed at this point in time, the state is not changed
+            bool would_allow(uint32_t now) const
+            {
+                return this->failures_ == 0 || (int32_t)(now - this->next_attempt_) >= 0;
+            }
+
+            // called for the attempt, which is actually made: the one of an open breaker is the probe
+            void record_attempt()
+            {
+                if (this->state_ == BreakerState::OPEN)
+                    this->state_ = BreakerState::HALF_OPEN;
+            }
+
+            // user action (i.e. the button press) proves the device is alive
+            void reset() { this->record_success(); }
+
+            void record_success()
+            {
+                this->failures_ = 0;
+                this->state_ = BreakerState::CLOSED;
+            }
+
+            void record_failure(uint32_t now)
+            {
+                if (this->failures_ < UINT8_MAX)
+                    this->failures_++;
+
+                if (this->state_ == BreakerState::HALF_OPEN || this->failures_ >= this->failure_threshold_)
+                {
+                    this->state_ = BreakerState::OPEN;
+                    this->next_attempt_ = now + this->jitter(this->max_backoff_);
+                    return;
+                }
+
+                // initial_backoff * 2^(failures - 1), capped by max_backoff
+                uint32_t backoff = this->initial_backoff_;
+                for (uint8_t i = 1; i < this->failures_ && backoff < this->max_backoff_; i++)
+                    backoff *= 2;
+                this->next_attempt_ = now + this->jitter(std::min(backoff, this->max_backoff_));
+            }
+
+            BreakerState state() const { return this->state_; }
+            uint8_t failures() const { return this->failures_; }
+            uint32_t next_attempt() const { return this->next_attempt_; }
+
+            static const char *state_to_string(BreakerState state)
+            {
+                switch (state)
+                {
+                case BreakerState::OPEN:
+                    return "open";
+                case BreakerState::HALF_OPEN:
+                    return "half_open";
+                case BreakerState::CLOSED:
+                default:
+                    return "closed";
+                }
+            }
+
+        protected:
+            // +-25% of the delay, so the devices failed at the same time do not retry at the same time
+            uint32_t jitter(uint32_t delay) { return delay - delay / 4 + random_uint32() % (delay / 2 + 1); }
+
+            BreakerState state_{BreakerState::CLOSED};
+            uint8_t failures_{0}; // consecutive
+            uint8_t failure_threshold_{5};
+            uint32_t initial_backoff_{10000};
+            uint32_t max_backoff_{600000};
+            uint32_t next_attempt_{0};
+        };
+
+    } // namespace danfoss_eco
+} // namespace esphome
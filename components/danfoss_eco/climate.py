@@ -1,9 +1,16 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import climate, ble_client, sensor, binary_sensor
+from esphome.components import climate, ble_client, sensor, binary_sensor, text_sensor, esp32_ble_tracker, time
 from esphome.const import (
     CONF_ID,
     CONF_NAME,
+    CONF_TIME_ID,
+    CONF_HOURS,
+    CONF_MINUTES,
+    CONF_SECONDS,
+    CONF_MODE,
+    CONF_TARGET_TEMPERATURE,
+    CONF_TIMEOUT,
     
     CONF_TEMPERATURE,
     CONF_BATTERY_LEVEL,
@@ -12,8 +19,11 @@ from esphome.const import (
     ENTITY_CATEGORY_DIAGNOSTIC,
     
     STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
     UNIT_PERCENT,
     UNIT_CELSIUS,
+    UNIT_SECOND,
+    UNIT_MILLISECOND,
     
     CONF_DEVICE_CLASS,
     DEVICE_CLASS_BATTERY,
@@ -21,20 +31,120 @@ from esphome.const import (
     DEVICE_CLASS_PROBLEM
 )
 
+from . import eco_ns, ConnectionScheduler, DanfossEco, CONF_DANFOSS_ECO_ID
+
 CODEOWNERS = ["@dmitry-cherkas"]
 DEPENDENCIES = ["ble_client"]
 # load zero-configuration dependencies automatically
-AUTO_LOAD = ["sensor", "binary_sensor", "esp32_ble_tracker"]
+AUTO_LOAD = ["sensor", "binary_sensor", "text_sensor", "esp32_ble_tracker", "danfoss_eco"]
 
 CONF_PIN_CODE = 'pin_code'
 CONF_SECRET_KEY = 'secret_key'
 CONF_PROBLEMS = 'problems'
+CONF_STALE = 'stale'
+CONF_ADAPTIVE_POLLING = 'adaptive_polling'
+CONF_MIN_INTERVAL = 'min_interval'
+CONF_MAX_INTERVAL = 'max_interval'
+CONF_EFFECTIVE_INTERVAL = 'effective_interval'
+CONF_SESSION_LINGER = 'session_linger'
+CONF_WRITE_DEBOUNCE = 'write_debounce'
+CONF_WRITE_VERIFICATION = 'write_verification'
+CONF_LATENCY = 'latency'
+CONF_SCHEDULE = 'schedule'
+CONF_WRITE_SCHEDULE = 'write_schedule'
+CONF_CLOCK_DRIFT_THRESHOLD = 'clock_drift_threshold'
+CONF_FROM = 'from'
+CONF_TO = 'to'
+CONF_REQUEST_TIMEOUT = 'request_timeout'
+CONF_REQUEST_RETRIES = 'request_retries'
+CONF_REQUEST_TIMEOUTS = 'request_timeouts'
+CONF_CIRCUIT_BREAKER = 'circuit_breaker'
+CONF_FAILURE_THRESHOLD = 'failure_threshold'
+CONF_INITIAL_BACKOFF = 'initial_backoff'
+CONF_MAX_BACKOFF = 'max_backoff'
+CONF_BREAKER_STATE = 'breaker_state'
+CONF_SUCCESSES = 'successes'
+CONF_CONNECTION_PARAMETERS = 'connection_parameters'
+CONF_FAILURES = 'failures'
+
+WriteVerification = eco_ns.enum("WriteVerification", is_class=True)
+WRITE_VERIFICATIONS = {
+    "none": WriteVerification.NONE,
+    "read_back": WriteVerification.READ_BACK,
+    "full_refresh": WriteVerification.FULL_REFRESH,
+}
+
+LatencyMetric = eco_ns.enum("LatencyMetric", is_class=True)
+LATENCY_METRICS = {
+    "connect": LatencyMetric.CONNECT,
+    "discovery": LatencyMetric.DISCOVERY,
+    "pin": LatencyMetric.PIN,
+    "read": LatencyMetric.READ,
+    "write": LatencyMetric.WRITE,
+    "disconnect": LatencyMetric.DISCONNECT,
+    "control": LatencyMetric.CONTROL,
+}
+
+LatencyStat = eco_ns.enum("LatencyStat", is_class=True)
+LATENCY_STATS = {
+    "p50": LatencyStat.P50,
+    "p95": LatencyStat.P95,
+    "max": LatencyStat.MAX,
+    CONF_SUCCESSES: LatencyStat.SUCCESSES,
+    CONF_FAILURES: LatencyStat.FAILURES,
+}
+
+def latency_stat_schema(stat):
+    if stat in (CONF_SUCCESSES, CONF_FAILURES):
+        return sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+        )
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+    )
+
+LATENCY_SCHEMA = cv.Schema({
+    cv.Optional(metric): cv.Schema({
+        cv.Optional(stat): latency_stat_schema(stat) for stat in LATENCY_STATS
+    }) for metric in LATENCY_METRICS
+})
+
+def validate_circuit_breaker(value):
+    if value[CONF_INITIAL_BACKOFF] > value[CONF_MAX_BACKOFF]:
+        raise cv.Invalid("initial_backoff should not be greater than max_backoff")
+    return value
+
+SCHEDULE_DAYS = ["monday", "tuesday", "wednesday", "thursday", "friday", "saturday", "sunday"]
 
-eco_ns = cg.esphome_ns.namespace("danfoss_eco")
-DanfossEco = eco_ns.class_(
-    "Device", climate.Climate, ble_client.BLEClientNode, cg.PollingComponent
+def validate_half_hour(value):
+    value = cv.time_of_day(value)
+    if value[CONF_SECONDS] != 0 or value[CONF_MINUTES] not in (0, 30):
+        raise cv.Invalid("Schedule time should be a multiple of 30 minutes")
+    # 30 minute steps since midnight
+    return value[CONF_HOURS] * 2 + value[CONF_MINUTES] // 30
+
+def validate_period(value):
+    if value[CONF_FROM] >= value[CONF_TO]:
+        raise cv.Invalid("Period should start before it ends")
+    return value
+
+SCHEDULE_PERIOD_SCHEMA = cv.All(
+    cv.Schema({
+        cv.Required(CONF_FROM): validate_half_hour,
+        cv.Required(CONF_TO): validate_half_hour,
+    }),
+    validate_period
 )
 
+SCHEDULE_SCHEMA = cv.Schema({
+    cv.Optional(day): cv.All(cv.ensure_list(SCHEDULE_PERIOD_SCHEMA), cv.Length(max=3)) for day in SCHEDULE_DAYS
+})
+
 def validate_secret(value):
     value = cv.string_strict(value)
     if len(value) != 32:
@@ -49,9 +159,41 @@ def validate_pin(value):
         raise cv.Invalid("PIN code should be numeric")
     return value
 
+def validate_adaptive_polling(value):
+    if value[CONF_MIN_INTERVAL] > value[CONF_MAX_INTERVAL]:
+        raise cv.Invalid("min_interval should not be greater than max_interval")
+    return value
+
+def validate_connection_parameters(value):
+    if value[CONF_MIN_INTERVAL] > value[CONF_MAX_INTERVAL]:
+        raise cv.Invalid("min_interval should not be greater than max_interval")
+    # supervision timeout should cover at least two connection events, skipped ones included
+    if value[CONF_TIMEOUT].total_microseconds <= 2 * (1 + value[CONF_LATENCY]) * value[CONF_MAX_INTERVAL].total_microseconds:
+        raise cv.Invalid("timeout should be greater than 2 * (1 + latency) * max_interval")
+    return value
+
+CONNECTION_INTERVAL = cv.All(
+    cv.positive_time_period_microseconds,
+    cv.Range(min=cv.TimePeriod(microseconds=7500), max=cv.TimePeriod(seconds=4))
+)
+
+CONNECTION_PARAMETERS_SCHEMA = cv.All(
+    cv.Schema({
+        cv.Optional(CONF_MIN_INTERVAL, default="7.5ms"): CONNECTION_INTERVAL,
+        cv.Optional(CONF_MAX_INTERVAL, default="15ms"): CONNECTION_INTERVAL,
+        cv.Optional(CONF_LATENCY, default=0): cv.int_range(min=0, max=499),
+        cv.Optional(CONF_TIMEOUT, default="2s"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(milliseconds=100), max=cv.TimePeriod(seconds=32))
+        ),
+    }),
+    validate_connection_parameters
+)
+
 CONFIG_SCHEMA = (
     climate.climate_schema(DanfossEco).extend(
         {
+            cv.GenerateID(CONF_DANFOSS_ECO_ID): cv.use_id(ConnectionScheduler),
             cv.Optional(CONF_SECRET_KEY): validate_secret,
             cv.Optional(CONF_PIN_CODE): validate_pin,
             cv.Optional(CONF_BATTERY_LEVEL): sensor.sensor_schema(
@@ -71,10 +213,56 @@ CONFIG_SCHEMA = (
                 cv.Optional(CONF_NAME): cv.string,
                 cv.Optional(CONF_ENTITY_CATEGORY, default=ENTITY_CATEGORY_DIAGNOSTIC): cv.entity_category,
                 cv.Optional(CONF_DEVICE_CLASS, default=DEVICE_CLASS_PROBLEM): binary_sensor.validate_device_class
-            })
+            }),
+            cv.Optional(CONF_STALE): binary_sensor.binary_sensor_schema(
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+            ),
+            cv.Optional(CONF_ADAPTIVE_POLLING): cv.All(
+                cv.Schema({
+                    cv.Required(CONF_MIN_INTERVAL): cv.positive_time_period_milliseconds,
+                    cv.Required(CONF_MAX_INTERVAL): cv.positive_time_period_milliseconds,
+                }),
+                validate_adaptive_polling
+            ),
+            cv.Optional(CONF_CONNECTION_PARAMETERS): CONNECTION_PARAMETERS_SCHEMA,
+            cv.Optional(CONF_SESSION_LINGER, default="0s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_WRITE_DEBOUNCE, default="0s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_WRITE_VERIFICATION, default={}): cv.Schema({
+                cv.Optional(CONF_TARGET_TEMPERATURE, default="read_back"): cv.enum(WRITE_VERIFICATIONS, lower=True),
+                cv.Optional(CONF_MODE, default="read_back"): cv.enum(WRITE_VERIFICATIONS, lower=True),
+            }),
+            cv.Optional(CONF_REQUEST_TIMEOUT, default="5s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_REQUEST_RETRIES, default=1): cv.int_range(min=0, max=10),
+            cv.Optional(CONF_REQUEST_TIMEOUTS): sensor.sensor_schema(
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+            ),
+            cv.Optional(CONF_SCHEDULE): SCHEDULE_SCHEMA,
+            cv.Optional(CONF_WRITE_SCHEDULE, default=False): cv.boolean,
+            cv.Optional(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
+            cv.Optional(CONF_CLOCK_DRIFT_THRESHOLD, default="60s"): cv.positive_time_period_seconds,
+            cv.Optional(CONF_LATENCY): LATENCY_SCHEMA,
+            cv.Optional(CONF_CIRCUIT_BREAKER, default={}): cv.All(
+                cv.Schema({
+                    cv.Optional(CONF_FAILURE_THRESHOLD, default=5): cv.int_range(min=1, max=255),
+                    cv.Optional(CONF_INITIAL_BACKOFF, default="10s"): cv.positive_time_period_milliseconds,
+                    cv.Optional(CONF_MAX_BACKOFF, default="10min"): cv.positive_time_period_milliseconds,
+                }),
+                validate_circuit_breaker
+            ),
+            cv.Optional(CONF_BREAKER_STATE): text_sensor.text_sensor_schema(
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+            ),
+            cv.Optional(CONF_EFFECTIVE_INTERVAL): sensor.sensor_schema(
+                unit_of_measurement=UNIT_SECOND,
+                accuracy_decimals=0,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+            )
         }
     )
     .extend(ble_client.BLE_CLIENT_SCHEMA)
+    .extend(esp32_ble_tracker.ESP_BLE_DEVICE_SCHEMA)
     .extend(cv.polling_component_schema("60s"))
 )
 
@@ -83,9 +271,30 @@ async def to_code(config):
     await cg.register_component(var, config)
     await climate.register_climate(var, config)
     await ble_client.register_ble_node(var, config)
-    
+    await esp32_ble_tracker.register_ble_device(var, config)
+
+    scheduler = await cg.get_variable(config[CONF_DANFOSS_ECO_ID])
+    cg.add(scheduler.register_device(var))
+
     cg.add(var.set_secret_key(config.get(CONF_SECRET_KEY, "")))
     cg.add(var.set_pin_code(config.get(CONF_PIN_CODE, "")))
+    if CONF_CONNECTION_PARAMETERS in config:
+        conn = config[CONF_CONNECTION_PARAMETERS]
+        # BLE units: 1.25 ms for the intervals, 10 ms for the supervision timeout
+        cg.add(var.set_connection_parameters(
+            conn[CONF_MIN_INTERVAL].total_microseconds // 1250,
+            conn[CONF_MAX_INTERVAL].total_microseconds // 1250,
+            conn[CONF_LATENCY],
+            conn[CONF_TIMEOUT].total_milliseconds // 10
+        ))
+    cg.add(var.set_session_linger(config[CONF_SESSION_LINGER]))
+    cg.add(var.set_write_debounce(config[CONF_WRITE_DEBOUNCE]))
+    cg.add(var.set_request_timeout(config[CONF_REQUEST_TIMEOUT], config[CONF_REQUEST_RETRIES]))
+    breaker = config[CONF_CIRCUIT_BREAKER]
+    cg.add(var.set_circuit_breaker(breaker[CONF_FAILURE_THRESHOLD], breaker[CONF_INITIAL_BACKOFF], breaker[CONF_MAX_BACKOFF]))
+    verification = config[CONF_WRITE_VERIFICATION]
+    cg.add(var.set_temperature_verification(verification[CONF_TARGET_TEMPERATURE]))
+    cg.add(var.set_mode_verification(verification[CONF_MODE]))
     
     if CONF_BATTERY_LEVEL in config:
         sens = await sensor.new_sensor(config[CONF_BATTERY_LEVEL])
@@ -96,4 +305,34 @@ async def to_code(config):
     if CONF_PROBLEMS in config:
         b_sens = await binary_sensor.new_binary_sensor(config[CONF_PROBLEMS])
         cg.add(var.set_problems(b_sens))
-    
+    if CONF_STALE in config:
+        b_sens = await binary_sensor.new_binary_sensor(config[CONF_STALE])
+        cg.add(var.set_stale(b_sens))
+    if CONF_ADAPTIVE_POLLING in config:
+        adaptive = config[CONF_ADAPTIVE_POLLING]
+        cg.add(var.set_adaptive_polling(adaptive[CONF_MIN_INTERVAL], adaptive[CONF_MAX_INTERVAL]))
+    if CONF_EFFECTIVE_INTERVAL in config:
+        sens = await sensor.new_sensor(config[CONF_EFFECTIVE_INTERVAL])
+        cg.add(var.set_effective_interval(sens))
+    if CONF_REQUEST_TIMEOUTS in config:
+        sens = await sensor.new_sensor(config[CONF_REQUEST_TIMEOUTS])
+        cg.add(var.set_request_timeouts(sens))
+    if CONF_BREAKER_STATE in config:
+        t_sens = await text_sensor.new_text_sensor(config[CONF_BREAKER_STATE])
+        cg.add(var.set_breaker_state(t_sens))
+    if CONF_TIME_ID in config:
+        time_ = await cg.get_variable(config[CONF_TIME_ID])
+        cg.add(var.set_time(time_))
+        cg.add(var.set_clock_drift_threshold(config[CONF_CLOCK_DRIFT_THRESHOLD]))
+    if CONF_SCHEDULE in config:
+        cg.add(var.set_write_schedule(config[CONF_WRITE_SCHEDULE]))
+        for day, periods in config[CONF_SCHEDULE].items():
+            index = SCHEDULE_DAYS.index(day)
+            cg.add(var.add_schedule_day(index))
+            for period in periods:
+                cg.add(var.add_schedule_period(index, period[CONF_FROM], period[CONF_TO]))
+    if CONF_LATENCY in config:
+        for metric, stats in config[CONF_LATENCY].items():
+            for stat, sens_config in stats.items():
+                sens = await sensor.new_sensor(sens_config)
+                cg.add(var.set_latency_sensor(LATENCY_METRICS[metric], LATENCY_STATS[stat], sens))
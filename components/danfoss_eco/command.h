@@ -1,19 +1,17 @@
 #pragma once
 
+#include "esphome/core/hal.h"
 #include "esphome/components/esp32_ble_tracker/esp32_ble_tracker.h"
 
 #include "properties.h"
 
-#include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
-
 namespace esphome
 {
     namespace danfoss_eco
     {
         using namespace std;
 
-        enum class CommandType
+        enum class CommandType : uint8_t
         {
             READ,
             WRITE
@@ -21,16 +19,15 @@ namespace esphome
 
         struct Command
         {
-            Command(CommandType t, shared_ptr<DeviceProperty> const &p) : type(t), property(p) {}
-
-            CommandType type; // 0 - read, 1 - write
-            shared_ptr<DeviceProperty> property;
+            DeviceProperty *property;
+            uint32_t enqueued_at; // millis()
+            CommandType type;     // last, so the struct is not padded on 64-bit hosts
 
             bool execute(esphome::ble_client::BLEClient *client)
             {
                 if (this->type == CommandType::WRITE)
                 {
-                    WritableProperty *wp = static_cast<WritableProperty *>(this->property.get());
+                    WritableProperty *wp = static_cast<WritableProperty *>(this->property);
                     return wp->write_request(client);
                 }
                 else
@@ -38,54 +35,259 @@ namespace esphome
             }
         };
 
-        // Start with 32 entries.
-        // Log queue size/usage or add backpressure warnings.
-        // Scale up to 64 only if you observe dropped or missing advertisements
+        // Consecutive reads, which are sent as a single ATT Read Multiple request.
+        // Response carries the values back to back, so it is split using the expected value lengths.
+        struct ReadBatch
+        {
+            static constexpr uint8_t MAX_SIZE = 4;
+
+            DeviceProperty *properties[MAX_SIZE];
+            uint8_t size{0};
+            uint16_t length{0}; // expected response length
+
+            // returns false, if the property does not fit into the response of max_length bytes
+            bool add(DeviceProperty *property, uint16_t max_length)
+            {
+                if (this->size == MAX_SIZE || this->length + property->value_length() > max_length)
+                    return false;
+
+                this->properties[this->size++] = property;
+                this->length += property->value_length();
+                return true;
+            }
+
+            bool execute(esphome::ble_client::BLEClient *client)
+            {
+                esp_gattc_multi_t multi{};
+                multi.num_attr = this->size;
+                uint32_t now = millis();
+                for (uint8_t i = 0; i < this->size; i++)
+                {
+                    multi.handles[i] = this->properties[i]->handle;
+                    this->properties[i]->requested_at = now;
+                }
+
+                auto status = esp_ble_gattc_read_multiple(client->get_gattc_if(), client->get_conn_id(), &multi, ESP_GATT_AUTH_REQ_NONE);
+                if (status != ESP_OK)
+                    ESP_LOGW(TAG, "esp_ble_gattc_read_multiple failed, status=%01x", status);
+
+                return status == ESP_OK;
+            }
+        };
+
+        // Consecutive reads, which are packed into as few ReadBatches as the response length allows:
+        // the longest values go first and each one is put into the first batch it fits (first-fit decreasing).
+        // With the default MTU the poll reads take two requests, settings+battery (17) and temperature+errors (16).
+        struct ReadPlan
+        {
+            static constexpr uint8_t MAX_READS = 8;
+
+            DeviceProperty *reads[MAX_READS];
+            uint8_t size{0};
+
+            // returns false, if the plan is full
+            bool add(DeviceProperty *property)
+            {
+                if (this->size == MAX_READS)
+                    return false;
+
+                // kept sorted by the value length, longest first
+                uint8_t i = this->size++;
+                for (; i > 0 && this->reads[i - 1]->value_length() < property->value_length(); i--)
+                    this->reads[i] = this->reads[i - 1];
+                this->reads[i] = property;
+                return true;
+            }
+
+            // fills batches (MAX_READS at most), values of each batch fit into max_length bytes; returns the number of batches
+            uint8_t pack(uint16_t max_length, ReadBatch *batches) const
+            {
+                uint8_t count = 0;
+                for (uint8_t i = 0; i < this->size; i++)
+                {
+                    uint8_t j = 0;
+                    while (j < count && !batches[j].add(this->reads[i], max_length))
+                        j++;
+                    if (j == count)
+                    {
+                        batches[count] = ReadBatch();
+                        batches[count++].add(this->reads[i], max_length);
+                    }
+                }
+                return count;
+            }
+        };
+
+        enum class PushResult : uint8_t
+        {
+            QUEUED,
+            MERGED,  // same command is already queued, writes pack the latest property data at execution time
+            DROPPED, // queue is full
+        };
+
+        // Fixed-capacity ring of commands, it never allocates and never blocks the caller.
+        // Commands are pushed and popped from the main loop only, so no locking is required.
+        // Same command is never queued twice: the reads of a poll (5), the PIN, both control writes
+        // and a clock or schedule step (one at a time) fit into 10 entries.
         class CommandQueue
         {
         protected:
-            QueueHandle_t queue_handle_;
-            static constexpr size_t QUEUE_SIZE = 32;
+            static constexpr uint8_t QUEUE_SIZE = 10;
+
+            Command commands_[QUEUE_SIZE];
+            uint8_t head_{0};
+            uint8_t size_{0};
+
+            uint8_t high_water_mark_{0};
+            uint32_t dropped_{0};
+            uint32_t merged_{0};
+
+            uint32_t executed_{0};
+            uint32_t last_latency_{0};
+            uint32_t max_latency_{0};
+            uint64_t total_latency_{0};
 
         public:
-            CommandQueue()
+            PushResult push(CommandType type, DeviceProperty *property)
             {
-                queue_handle_ = xQueueCreate(QUEUE_SIZE, sizeof(Command *));
+                if (this->contains(type, property))
+                {
+                    this->merged_++;
+                    return PushResult::MERGED;
+                }
+
+                if (this->size_ == QUEUE_SIZE)
+                {
+                    this->dropped_++;
+                    return PushResult::DROPPED;
+                }
+
+                this->commands_[(this->head_ + this->size_) % QUEUE_SIZE] = Command{property, millis(), type};
+                this->size_++;
+                if (this->size_ > this->high_water_mark_)
+                    this->high_water_mark_ = this->size_;
+
+                return PushResult::QUEUED;
+            }
+
+            // commands are popped right before the execution, so enqueue-to-execute latency is measured here
+            bool pop(Command &cmd)
+            {
+                if (this->size_ == 0)
+                    return false;
+
+                cmd = this->commands_[this->head_];
+                this->head_ = (this->head_ + 1) % QUEUE_SIZE;
+                this->size_--;
+
+                this->last_latency_ = millis() - cmd.enqueued_at;
+                if (this->last_latency_ > this->max_latency_)
+                    this->max_latency_ = this->last_latency_;
+                this->total_latency_ += this->last_latency_;
+                this->executed_++;
+                return true;
             }
 
-            ~CommandQueue()
+            bool contains(CommandType type, const DeviceProperty *property) const
             {
-                if (queue_handle_ != nullptr)
+                for (uint8_t i = 0; i < this->size_; i++)
                 {
-                    // Clean up any remaining commands
-                    Command *cmd;
-                    while (xQueueReceive(queue_handle_, &cmd, 0) == pdTRUE)
-                    {
-                        delete cmd;
-                    }
-                    vQueueDelete(queue_handle_);
+                    const Command &cmd = this->commands_[(this->head_ + i) % QUEUE_SIZE];
+                    if (cmd.type == type && cmd.property == property)
+                        return true;
                 }
+                return false;
             }
 
-            void push(Command *cmd)
+            bool empty() const { return this->size_ == 0; }
+            uint8_t size() const { return this->size_; }
+            static constexpr uint8_t capacity() { return QUEUE_SIZE; }
+
+            uint8_t high_water_mark() const { return this->high_water_mark_; }
+            uint32_t dropped() const { return this->dropped_; }
+            uint32_t merged() const { return this->merged_; }
+            uint32_t last_latency() const { return this->last_latency_; }
+            uint32_t max_latency() const { return this->max_latency_; }
+            uint32_t avg_latency() const { return this->executed_ == 0 ? 0 : this->total_latency_ / this->executed_; }
+        };
+
+        // Request, which was sent to the device and is waiting for the response
+        struct PendingRequest
+        {
+            CommandType type;
+            uint16_t handle;   // INVALID_HANDLE for read multiple, responses to those are matched in order
+            uint32_t deadline; // millis()
+        };
+
+        // Fixed-capacity list of the requests in flight, ordered by the time they were sent.
+        class PendingRequests
+        {
+        public:
+            // every request is sent for a queued command, a read multiple covers several of them
+            static constexpr uint8_t MAX_PENDING = CommandQueue::capacity();
+
+            // returns false, if there is no room left
+            bool add(CommandType type, uint16_t handle, uint32_t deadline)
             {
-                xQueueSend(queue_handle_, &cmd, portMAX_DELAY);
+                if (this->size_ == MAX_PENDING)
+                    return false;
+
+                this->requests_[this->size_++] = PendingRequest{type, handle, deadline};
+                return true;
             }
 
-            Command *pop()
+            // removes the oldest matching request, returns false if there is none (i.e. it has expired already)
+            bool complete(CommandType type, uint16_t handle)
             {
-                Command *cmd = nullptr;
-                if (xQueueReceive(queue_handle_, &cmd, 0) == pdTRUE)
+                for (uint8_t i = 0; i < this->size_; i++)
                 {
-                    return cmd;
+                    if (this->requests_[i].type == type && this->requests_[i].handle == handle)
+                    {
+                        this->remove(i);
+                        return true;
+                    }
                 }
-                return nullptr;
+                return false;
             }
 
-            bool empty() const
+            // removes the oldest expired request into expired, returns false if there is none
+            bool pop_expired(uint32_t now, PendingRequest &expired)
             {
-                return uxQueueMessagesWaiting(queue_handle_) == 0;
+                for (uint8_t i = 0; i < this->size_; i++)
+                {
+                    if ((int32_t)(now - this->requests_[i].deadline) >= 0)
+                    {
+                        expired = this->requests_[i];
+                        this->remove(i);
+                        return true;
+                    }
+                }
+                return false;
             }
+
+            bool contains(CommandType type, uint16_t handle) const
+            {
+                for (uint8_t i = 0; i < this->size_; i++)
+                    if (this->requests_[i].type == type && this->requests_[i].handle == handle)
+                        return true;
+                return false;
+            }
+
+            void clear() { this->size_ = 0; }
+            bool empty() const { return this->size_ == 0; }
+            uint8_t size() const { return this->size_; }
+
+        protected:
+            void remove(uint8_t index)
+            {
+                for (uint8_t i = index + 1; i < this->size_; i++)
+                    this->requests_[i - 1] = this->requests_[i];
+                this->size_--;
+            }
+
+            PendingRequest requests_[MAX_PENDING];
+            uint8_t size_{0};
         };
+
     } // namespace danfoss_eco
 } // namespace esphome
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "esphome/core/hal.h"
+
+namespace esphome
+{
+    namespace danfoss_eco
+    {
+        // phases of a single connection cycle, in the order they happen on the wire
+        enum class CyclePhase : uint8_t
+        {
+            CONNECT = 0, // connect() -> ESP_GATTC_OPEN_EVT
+            DISCOVERY,   // ESP_GATTC_OPEN_EVT -> ESP_GATTC_SEARCH_CMPL_EVT
+            PIN,         // ESP_GATTC_SEARCH_CMPL_EVT -> PIN write acknowledged
+            REQUESTS,    // PIN write acknowledged -> last pending read/write answered
+            DISCONNECT   // disconnect() -> ESP_GATTC_DISCONNECT_EVT
+        };
+
+        inline constexpr uint8_t CYCLE_PHASE_COUNT = 5;
+
+        // Measures how long each phase of a connection cycle takes, from connect() to the disconnect event
+        class CycleTimer
+        {
+        public:
+            void start()
+            {
+                this->started_at_ = millis();
+                this->last_mark_ = this->started_at_;
+                for (uint8_t i = 0; i < CYCLE_PHASE_COUNT; i++)
+                    this->durations_[i] = 0;
+                this->running_ = true;
+            }
+
+            // closes the given phase, attributing the time since the previous mark to it
+            void mark(CyclePhase phase)
+            {
+                if (!this->running_)
+                    return;
+
+                uint32_t now = millis();
+                this->durations_[(uint8_t)phase] += now - this->last_mark_;
+                this->last_mark_ = now;
+            }
+
+            // returns false, if there was no cycle in progress
+            bool finish()
+            {
+                if (!this->running_)
+                    return false;
+
+                this->mark(CyclePhase::DISCONNECT);
+                this->total_ = this->last_mark_ - this->started_at_;
+                this->running_ = false;
+                this->cycles_++;
+                return true;
+            }
+
+            // drops the cycle in progress (i.e. the link was never opened), the next start() begins a new one
+            void cancel() { this->running_ = false; }
+
+            bool is_running() const { return this->running_; }
+            uint32_t duration(CyclePhase phase) const { return this->durations_[(uint8_t)phase]; }
+            uint32_t total() const { return this->total_; }
+            uint32_t cycles() const { return this->cycles_; }
+
+        protected:
+            bool running_{false};
+            uint32_t started_at_{0};
+            uint32_t last_mark_{0};
+            uint32_t durations_[CYCLE_PHASE_COUNT]{0};
+            uint32_t total_{0};
+            uint32_t cycles_{0};
+        };
+
+    } // namespace danfoss_eco
+} // namespace esphome
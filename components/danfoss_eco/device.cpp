@@ -9,59 +9,219 @@ namespace esphome
   {
     void Device::setup()
     {
-      shared_ptr<MyComponent> sp_this(this);
+      this->add_property(&this->p_pin);
+      this->add_property(&this->p_battery);
+      this->add_property(&this->p_temperature);
+      this->add_property(&this->p_settings);
+      this->add_property(&this->p_errors);
+      this->add_property(&this->p_secret_key);
+      if (this->clock_enabled())
+      {
+        this->p_current_time = new CurrentTimeProperty(this, &this->xxtea);
+        this->p_current_time->verification = WriteVerification::NONE;
+        this->add_property(this->p_current_time);
+      }
+      if (this->schedule_enabled())
+      {
+        this->p_schedule_select = new ScheduleDaySelectProperty(this, &this->xxtea);
+        this->p_schedule_day = new ScheduleDayProperty(this, &this->xxtea);
+        this->add_property(this->p_schedule_select);
+        this->add_property(this->p_schedule_day);
+        this->load_schedule_cache();
+      }
+      this->cached_properties_[0] = &this->p_pin;
+      this->cached_properties_[1] = &this->p_battery;
+      this->cached_properties_[2] = &this->p_temperature;
+      this->cached_properties_[3] = &this->p_settings;
+      this->cached_properties_[4] = &this->p_errors;
+      this->load_handle_cache();
+      this->restore_state();
+      if (this->stale_ != nullptr)
+        this->stale_->publish_state(this->state_stale_);
 
-      this->p_pin = make_shared<WritableProperty>(sp_this, xxtea, SERVICE_SETTINGS, CHARACTERISTIC_PIN);
-      this->p_battery = make_shared<BatteryProperty>(sp_this, xxtea);
-      this->p_temperature = make_shared<TemperatureProperty>(sp_this, xxtea);
-      this->p_settings = make_shared<SettingsProperty>(sp_this, xxtea);
-      this->p_errors = make_shared<ErrorsProperty>(sp_this, xxtea);
-      this->p_secret_key = make_shared<SecretKeyProperty>(sp_this, xxtea);
+      this->p_temperature.verification = this->temperature_verification_;
+      this->p_settings.verification = this->mode_verification_;
 
-      this->properties = {this->p_pin, this->p_battery, this->p_temperature, this->p_settings, this->p_errors, this->p_secret_key};
       // pretend, we have already discovered the device
       copy_address(this->parent()->get_address(), this->parent()->get_remote_bda());
+
+      // poller is started after setup(), so the initial interval does not require a restart
+      if (this->adaptive_polling_)
+        this->set_update_interval(std::max(this->min_interval_, std::min(this->get_update_interval(), this->max_interval_)));
+      if (this->effective_interval_ != nullptr)
+        this->effective_interval_->publish_state(this->get_update_interval() / 1000.0f);
+      this->publish_breaker_state();
     }
 
     void Device::loop()
     {
+      // ble_client should not connect on its own, connections are initiated by the scheduler.
+      // It enables itself in its setup(), which runs after ours, so it is disabled here (unless a connection was granted already)
+      if (!this->ble_client_disabled_)
+      {
+        this->ble_client_disabled_ = true;
+        if (!this->attempt_in_progress_)
+          this->parent()->set_enabled(false);
+      }
+
       if (this->status_has_error())
       {
+        this->record_connection_result(false);
         this->disconnect();
         this->status_clear_error();
       }
 
+      this->flush_pending_writes();
+
       if (this->node_state != ClientState::ESTABLISHED)
         return;
 
-      Command *cmd = this->commands_.pop();
-      while (cmd != nullptr)
+      PendingRequest expired;
+      while (this->pending_.pop_expired(millis(), expired))
+        this->on_request_timeout(expired);
+
+      Command cmd;
+      ReadPlan plan;
+      // keep room for the planned reads, which could be sent as single reads, and for one more request
+      while (this->pending_.size() + plan.size + 1 < PendingRequests::MAX_PENDING && this->commands_.pop(cmd))
       {
-        if (cmd->execute(this->parent()))
-          this->request_counter_++;
+        // consecutive reads are collected into a plan, which is flushed before any write to keep the order
+        bool batched = this->read_multiple_supported_ && cmd.type == CommandType::READ && cmd.property->value_length() < this->mtu_;
+        if (batched && plan.add(cmd.property))
+          continue;
+
+        this->send_read_plan(plan);
+        plan = ReadPlan();
+        if (batched && plan.add(cmd.property))
+          continue;
 
-        delete cmd;
-        cmd = this->commands_.pop();
+        if (cmd.execute(this->parent()))
+          this->track_request(cmd.type, cmd.property->handle);
       }
+      this->send_read_plan(plan);
 
       // once we are done with pending commands - check to see if there are any pending requests
       // if there are no pending requests - we are done with the device for now and should disconnect
-      if (this->request_counter_ == 0)
+      if (this->pending_.empty() && this->commands_.empty())
+      {
+        // settings read, which the mode change was waiting for, has failed
+        if (this->p_settings.write_pending && !this->p_settings.confirmed)
+        {
+          ESP_LOGE(TAG, "[%s] settings could not be read, mode change is dropped", this->get_name().c_str());
+          this->p_settings.write_pending = false;
+          if (this->control_started_at_ != 0)
+            this->finish_control(false);
+        }
+
+        // debounced writes are about to be queued
+        if (this->p_temperature.write_pending || this->p_settings.write_pending)
+          return;
+
+        // after user initiated changes the link is kept open for follow-up changes, till it gets idle
+        if (this->lingering_ && millis() - this->last_activity_ < this->session_linger_)
+          return;
+
+        // characteristics, which are not cached, are resolved once the service discovery completes
+        if (this->optional_handles_pending())
+          return;
+
+        // clock and schedule changes are sent over the same connection
+        if (this->sync_clock() || this->send_next_schedule_day())
+          return;
+
+        this->cycle_timer_.mark(CyclePhase::REQUESTS);
+        this->save_state();
         this->disconnect();
+        this->adapt_update_interval();
+      }
     }
 
     void Device::update()
     {
-      this->connect();
+      if (this->scheduler_->is_queued(this))
+      {
+        ESP_LOGD(TAG, "[%s] previous poll is still waiting for a connection slot", this->get_name().c_str());
+        return;
+      }
+
+      this->request_state();
+      this->scheduler_->request_poll(this);
+    }
+
+    void Device::request_connection()
+    {
+      this->scheduler_->request_connection(this);
+    }
+
+    void Device::request_control_session()
+    {
+      if (this->session_linger_ > 0)
+      {
+        this->lingering_ = true;
+        this->last_activity_ = millis();
+      }
+      this->request_connection();
+    }
+
+    void Device::schedule_write(WritableProperty *property)
+    {
+      if (this->control_started_at_ == 0)
+        this->control_started_at_ = millis() | 1; // 0 is reserved for "no control in progress"
+      // the data was updated already, so a pending write will send the latest value
+      if (property->write_pending)
+      {
+        this->coalesced_writes_++;
+        ESP_LOGD(TAG, "[%s] coalescing write for handle=%#04x", this->get_name().c_str(), property->handle);
+      }
+
+      property->write_pending = true;
+      property->write_due = millis() + this->write_debounce_;
+
+      // connection is requested right away, so it is being established during the debounce window
+      this->request_control_session();
+      this->flush_pending_writes();
+    }
+
+    void Device::flush_pending_writes()
+    {
+      uint32_t now = millis();
+      for (WritableProperty *property : {(WritableProperty *)&this->p_temperature, (WritableProperty *)&this->p_settings})
+      {
+        if (!property->write_pending || (int32_t)(now - property->write_due) < 0)
+          continue;
 
-      if (this->xxtea->status() == XXTEA_STATUS_SUCCESS)
+        // settings restored from flash could be outdated, the mode is merged into the ones read from the device first
+        if (property == &this->p_settings && !this->p_settings.confirmed)
+        {
+          if (!this->is_established())
+            this->request_connection();
+          continue;
+        }
+
+        property->write_pending = false;
+        if (this->queue_command(CommandType::WRITE, property) == PushResult::MERGED)
+          this->coalesced_writes_++;
+
+        this->last_activity_ = now;
+        // connection could be lost during the debounce window
+        if (!this->is_established())
+          this->request_connection();
+      }
+    }
+
+    void Device::request_state()
+    {
+      if (this->xxtea.status() == XXTEA_STATUS_SUCCESS)
       {
         ESP_LOGI(TAG, "[%s] requesting device state", this->get_name().c_str());
 
-        this->commands_.push(new Command(CommandType::READ, this->p_battery));
-        this->commands_.push(new Command(CommandType::READ, this->p_temperature));
-        this->commands_.push(new Command(CommandType::READ, this->p_settings));
-        this->commands_.push(new Command(CommandType::READ, this->p_errors));
+        this->queue_command(CommandType::READ, &this->p_battery);
+        this->queue_command(CommandType::READ, &this->p_temperature);
+        this->queue_command(CommandType::READ, &this->p_settings);
+        this->queue_command(CommandType::READ, &this->p_errors);
+        // clock is checked during the regular polls, so the sync does not cost an extra connection
+        if (this->clock_enabled() && this->p_current_time->handle != INVALID_HANDLE)
+          this->queue_command(CommandType::READ, this->p_current_time);
       }
     }
 
@@ -79,13 +239,13 @@ namespace esphome
 
       if (call.get_target_temperature().has_value())
       {
-        if (!this->p_temperature->data)
+        if (!this->p_temperature.has_data)
         {
           ESP_LOGE(TAG, "[%s] No temperature data - read first", this->get_name().c_str());
           return;
         }
 
-        TemperatureData &t_data = (TemperatureData &)(*this->p_temperature->data);
+        TemperatureData &t_data = this->p_temperature.data;
         float new_temp = *call.get_target_temperature();
         
         if (new_temp < 5.0f || new_temp > 30.0f)
@@ -97,20 +257,19 @@ namespace esphome
         if (std::abs(t_data.target_temperature - new_temp) >= 0.1f)
         {
           t_data.target_temperature = new_temp;
-          this->commands_.push(new Command(CommandType::WRITE, this->p_temperature));
-          this->connect();
+          this->schedule_write(&this->p_temperature);
         }
       }
 
       if (call.get_mode().has_value())
       {
-        if (!this->p_settings->data)
+        if (!this->p_settings.has_data)
         {
           ESP_LOGE(TAG, "[%s] No settings data - read first", this->get_name().c_str());
           return;
         }
 
-        SettingsData &s_data = (SettingsData &)(*this->p_settings->data);
+        SettingsData &s_data = this->p_settings.data;
         ClimateMode new_mode = *call.get_mode();
         ClimateMode current_mode = s_data.device_mode;
         
@@ -121,12 +280,80 @@ namespace esphome
           s_data.device_mode = new_mode;
           this->mode = s_data.device_mode;
           this->publish_state();
-          this->commands_.push(new Command(CommandType::WRITE, this->p_settings));
-          this->connect();
+          this->schedule_write(&this->p_settings);
+          if (!this->p_settings.confirmed)
+          {
+            ESP_LOGD(TAG, "[%s] settings were restored from flash, reading them before the mode is written", this->get_name().c_str());
+            this->queue_command(CommandType::READ, &this->p_settings);
+          }
         }
       }
     }
 
+    GroupApply Device::apply_group_command(const GroupCommand &command)
+    {
+      if ((command.target_temperature.has_value() && !this->p_temperature.has_data) ||
+          (command.mode.has_value() && !this->p_settings.has_data))
+      {
+        ESP_LOGW(TAG, "[%s] state was never read, group command is skipped", this->get_name().c_str());
+        return GroupApply::FAILED;
+      }
+
+      // control() handles a single change per call, mode goes first
+      this->group_pending_ = true;
+      if (command.mode.has_value())
+      {
+        ClimateCall call(this);
+        call.set_mode(*command.mode);
+        this->control(call);
+      }
+      if (command.target_temperature.has_value())
+      {
+        ClimateCall call(this);
+        call.set_target_temperature(*command.target_temperature);
+        this->control(call);
+      }
+      if (this->control_started_at_ != 0)
+        return GroupApply::STARTED;
+
+      // nothing was written: either the device is at the requested state already, or the value was rejected
+      this->group_pending_ = false;
+      bool temperature_ok = !command.target_temperature.has_value() || std::abs(this->p_temperature.data.target_temperature - *command.target_temperature) < 0.1f;
+      bool mode_ok = !command.mode.has_value() || this->p_settings.data.device_mode == *command.mode;
+      return temperature_ok && mode_ok ? GroupApply::DONE : GroupApply::FAILED;
+    }
+
+    bool Device::write_outstanding(const WritableProperty *property)
+    {
+      // writes are debounced, then queued, then sent; till acknowledged a read must not replace the desired value
+      return property->write_pending || this->commands_.contains(CommandType::WRITE, property) ||
+             this->pending_.contains(CommandType::WRITE, property->handle);
+    }
+
+    bool Device::control_writes_pending()
+    {
+      // the control is done once none of its writes is left
+      for (WritableProperty *property : {(WritableProperty *)&this->p_temperature, (WritableProperty *)&this->p_settings})
+        if (this->write_outstanding(property))
+          return true;
+      return false;
+    }
+
+    void Device::finish_control(bool success)
+    {
+      if (success)
+        this->record_latency(LatencyMetric::CONTROL, millis() - this->control_started_at_);
+      else
+        this->record_failure(LatencyMetric::CONTROL);
+      this->control_started_at_ = 0;
+
+      if (this->group_pending_)
+      {
+        this->group_pending_ = false;
+        this->scheduler_->on_group_result(this, success);
+      }
+    }
+
     void Device::gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param)
     {
       switch (event)
@@ -139,10 +366,41 @@ namespace esphome
         break;
 
       case ESP_GATTC_OPEN_EVT:
+        this->trace(event, 0, param->open.status);
         if (param->open.status == ESP_GATT_OK)
+        {
           ESP_LOGV(TAG, "[%s] open, conn_id=%d", this->get_name().c_str(), param->open.conn_id);
+          this->cycle_timer_.mark(CyclePhase::CONNECT);
+          this->record_latency(LatencyMetric::CONNECT, this->cycle_timer_.duration(CyclePhase::CONNECT));
+
+          this->mtu_ = ESP_GATT_DEF_BLE_MTU_SIZE;
+          this->batches_in_flight_ = 0;
+          this->pending_.clear();
+          this->schedule_attempted_ = 0;
+          this->clock_synced_ = false;
+          if (this->clock_enabled())
+            this->p_current_time->has_data = false; // drift is calculated with the time read in the same session
+          this->schedule_writing_ = -1;
+          this->search_complete_ = false;
+          this->request_connection_parameters(param->open.remote_bda);
+          if (this->apply_handle_cache())
+          {
+            // characteristics can be accessed by handle, while ble_client is still running the service discovery
+            this->cycle_timer_.mark(CyclePhase::DISCOVERY);
+            this->record_latency(LatencyMetric::DISCOVERY, this->cycle_timer_.duration(CyclePhase::DISCOVERY));
+            this->write_pin();
+          }
+        }
         else
+        {
           ESP_LOGW(TAG, "[%s] failed to open, conn_id=%d, status=%#04x", this->get_name().c_str(), param->open.conn_id, param->open.status);
+          this->record_failure(LatencyMetric::CONNECT);
+          this->record_connection_result(false);
+          // backoff till the next attempt should not be counted into its CONNECT phase
+          this->cycle_timer_.cancel();
+          // slot is handed to the next device right away, instead of waiting for connection_timeout
+          this->disconnect();
+        }
         break;
 
       case ESP_GATTC_CLOSE_EVT:
@@ -153,18 +411,37 @@ namespace esphome
         break;
 
       case ESP_GATTC_DISCONNECT_EVT:
+        this->trace(event, 0, (uint8_t)param->disconnect.reason);
         ESP_LOGD(TAG, "[%s] disconnect, conn_id=%d, reason=%#04x", this->get_name().c_str(), param->disconnect.conn_id, (int)param->disconnect.reason);
+        this->record_connection_result(false); // connection was lost before the PIN was accepted
+        if (this->cycle_timer_.finish())
+        {
+          this->record_latency(LatencyMetric::DISCONNECT, this->cycle_timer_.duration(CyclePhase::DISCONNECT));
+          this->log_cycle_time();
+          this->publish_latency();
+        }
+        // link could be dropped by the device, the slot is released and ble_client does not reconnect on its own
+        this->disconnect();
         break;
 
       case ESP_GATTC_SEARCH_CMPL_EVT:
-        for (auto p : this->properties)
-          p->init_handle(this->parent());
+        this->trace(event, 0, param->search_cmpl.status);
+        this->search_complete_ = true;
+        if (this->handles_from_cache_)
+        {
+          // PIN was written using cached handles already
+          this->resolve_optional_handles();
+          break;
+        }
 
+        this->cycle_timer_.mark(CyclePhase::DISCOVERY);
+        this->record_latency(LatencyMetric::DISCOVERY, this->cycle_timer_.duration(CyclePhase::DISCOVERY));
+        this->resolve_handles();
         write_pin();
         break;
 
       case ESP_GATTC_WRITE_CHAR_EVT:
-        if (param->write.handle == this->p_pin->handle)
+        if (param->write.handle == this->p_pin.handle)
           this->on_write_pin(param->write);
         else
           this->on_write(param->write);
@@ -174,12 +451,68 @@ namespace esphome
         this->on_read(param->read);
         break;
 
+      case ESP_GATTC_READ_MULTIPLE_EVT:
+        this->on_read_multiple(param->read);
+        break;
+
+      case ESP_GATTC_CFG_MTU_EVT:
+        this->trace(event, param->cfg_mtu.mtu, param->cfg_mtu.status);
+        if (param->cfg_mtu.status == ESP_GATT_OK)
+          this->mtu_ = param->cfg_mtu.mtu;
+        break;
+
       default:
         ESP_LOGV(TAG, "[%s] unhandled event: event=%d, gattc_if=%d", this->get_name().c_str(), (int)event, gattc_if);
         break;
       }
     }
 
+    void Device::gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+    {
+      if (event != ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT || memcmp(param->update_conn_params.bda, this->parent()->get_remote_bda(), 6) != 0)
+        return;
+
+      if (param->update_conn_params.status != ESP_BT_STATUS_SUCCESS)
+      {
+        ESP_LOGW(TAG, "[%s] connection parameters were not updated, status=%#04x", this->get_name().c_str(), param->update_conn_params.status);
+        return;
+      }
+
+      // also reported, when the peer changes the parameters on its own
+      this->conn_interval_ = param->update_conn_params.conn_int;
+      this->conn_latency_ = param->update_conn_params.latency;
+      this->conn_timeout_ = param->update_conn_params.timeout;
+      ESP_LOGD(TAG, "[%s] connection parameters: interval %.2f ms, latency %d, timeout %d ms",
+               this->get_name().c_str(), this->conn_interval_ * 1.25f, this->conn_latency_, this->conn_timeout_ * 10);
+    }
+
+    void Device::request_connection_parameters(const esp_bd_addr_t remote_bda)
+    {
+      if (!this->conn_params_configured_)
+        return;
+
+      memcpy(this->conn_params_.bda, remote_bda, sizeof(esp_bd_addr_t));
+      auto status = esp_ble_gap_update_conn_params(&this->conn_params_);
+      if (status != ESP_OK)
+        ESP_LOGW(TAG, "[%s] esp_ble_gap_update_conn_params failed, status=%d", this->get_name().c_str(), status);
+    }
+
+    bool Device::parse_device(const esphome::esp32_ble_tracker::ESPBTDevice &device)
+    {
+      if (device.address_uint64() != this->parent()->get_address())
+        return false;
+
+      this->advertisement_seen_ = true;
+      this->last_seen_ = millis();
+      this->rssi_ = device.get_rssi();
+
+      const string &name = device.get_name();
+      if (!name.empty())
+        this->advertisement_flags_ = (uint8_t)name[0];
+
+      return true;
+    }
+
     void Device::write_pin()
     {
       ESP_LOGD(TAG, "[%s] writing pin", this->get_name().c_str());
@@ -187,56 +520,280 @@ namespace esphome
       uint8_t pin_bytes[sizeof(uint32_t)];
       write_int(pin_bytes, 0, this->pin_code_);
 
-      if (!this->p_pin->write_request(this->parent(), pin_bytes, sizeof(pin_bytes)))
+      if (!this->p_pin.write_request(this->parent(), pin_bytes, sizeof(pin_bytes)))
         this->status_set_error();
     }
 
     void Device::on_read(esp_ble_gattc_cb_param_t::gattc_read_char_evt_param param)
     {
-      this->request_counter_--;
+      this->trace(ESP_GATTC_READ_CHAR_EVT, param.handle, param.status, param.value, param.value_len);
+      if (!this->pending_.complete(CommandType::READ, param.handle))
+        ESP_LOGD(TAG, "[%s] late read response: handle=%#04x", this->get_name().c_str(), param.handle);
       if (param.status != ESP_GATT_OK)
       {
         ESP_LOGW(TAG, "[%s] failed to read characteristic: handle=%#04x, status=%#04x", this->get_name().c_str(), param.handle, param.status);
+        this->record_failure(LatencyMetric::READ);
+        if (param.status == ESP_GATT_INVALID_HANDLE && this->handles_from_cache_)
+          this->invalidate_handle_cache();
         return;
       }
 
-      auto device_property = find_if(properties.begin(), properties.end(),
-                                     [&param](shared_ptr<DeviceProperty> p)
-                                     { return p->handle == param.handle; });
-
-      if (device_property != properties.end())
-        (*device_property)->update_state(param.value, param.value_len);
+      DeviceProperty *device_property = this->find_property(param.handle);
+      if (device_property != nullptr)
+      {
+        this->record_latency(LatencyMetric::READ, millis() - device_property->requested_at);
+        device_property->retries = 0;
+        device_property->handle_value(param.value, param.value_len);
+        this->set_state_stale(false);
+        if (device_property == this->p_schedule_day)
+          this->on_schedule_day_read();
+      }
       else
         ESP_LOGW(TAG, "[%s] unknown property with handle=%#04x", this->get_name().c_str(), param.handle);
     }
 
+    void Device::send_read_plan(const ReadPlan &plan)
+    {
+      ReadBatch batches[ReadPlan::MAX_READS];
+      uint8_t count = plan.pack(this->mtu_ - 1, batches);
+      for (uint8_t i = 0; i < count; i++)
+        this->send_read_batch(batches[i]);
+    }
+
+    void Device::send_read_batch(ReadBatch &batch)
+    {
+      if (batch.size == 0)
+        return;
+
+      // there is nothing to gain from a batch of one
+      if (batch.size == 1 || this->batches_in_flight_ == MAX_BATCHES_IN_FLIGHT)
+      {
+        for (uint8_t i = 0; i < batch.size; i++)
+          if (batch.properties[i]->read_request(this->parent()))
+            this->track_request(CommandType::READ, batch.properties[i]->handle);
+        return;
+      }
+
+      if (!batch.execute(this->parent()))
+        return;
+
+      this->track_request(CommandType::READ, INVALID_HANDLE);
+      // responses arrive in the same order, as requests were sent
+      this->batches_[(this->batch_head_ + this->batches_in_flight_) % MAX_BATCHES_IN_FLIGHT] = batch;
+      this->batches_in_flight_++;
+    }
+
+    void Device::on_read_multiple(esp_ble_gattc_cb_param_t::gattc_read_char_evt_param param)
+    {
+      this->trace(ESP_GATTC_READ_MULTIPLE_EVT, param.handle, param.status, param.value, param.value_len);
+      // batch of the expired request is dropped already, the response can not be matched anymore
+      if (!this->pending_.complete(CommandType::READ, INVALID_HANDLE) || this->batches_in_flight_ == 0)
+      {
+        ESP_LOGW(TAG, "[%s] unexpected read multiple response, status=%#04x", this->get_name().c_str(), param.status);
+        return;
+      }
+
+      ReadBatch &batch = this->batches_[this->batch_head_];
+      this->batch_head_ = (this->batch_head_ + 1) % MAX_BATCHES_IN_FLIGHT;
+      this->batches_in_flight_--;
+
+      if (param.status != ESP_GATT_OK || param.value_len != batch.length)
+      {
+        this->record_failure(LatencyMetric::READ);
+        if (param.status == ESP_GATT_INVALID_HANDLE && this->handles_from_cache_)
+          this->invalidate_handle_cache();
+        else
+        {
+          ESP_LOGW(TAG, "[%s] read multiple is not supported, status=%#04x, length=%d, falling back to single reads", this->get_name().c_str(), param.status, param.value_len);
+          this->read_multiple_supported_ = false;
+        }
+
+        for (uint8_t i = 0; i < batch.size; i++)
+          this->queue_command(CommandType::READ, batch.properties[i]);
+        return;
+      }
+
+      this->record_latency(LatencyMetric::READ, millis() - batch.properties[0]->requested_at);
+      uint16_t offset = 0;
+      for (uint8_t i = 0; i < batch.size; i++)
+      {
+        batch.properties[i]->retries = 0;
+        batch.properties[i]->handle_value(param.value + offset, batch.properties[i]->value_length());
+        offset += batch.properties[i]->value_length();
+        if (batch.properties[i] == this->p_schedule_day)
+          this->on_schedule_day_read();
+      }
+      this->set_state_stale(false);
+    }
+
     void Device::on_write(esp_ble_gattc_cb_param_t::gattc_write_evt_param param)
     {
-      this->request_counter_--;
+      this->trace(ESP_GATTC_WRITE_CHAR_EVT, param.handle, param.status);
+      if (!this->pending_.complete(CommandType::WRITE, param.handle))
+        ESP_LOGD(TAG, "[%s] late write response: handle=%#04x", this->get_name().c_str(), param.handle);
+      this->last_activity_ = millis();
       if (param.status != ESP_GATT_OK)
+      {
         ESP_LOGW(TAG, "[%s] failed to write characteristic: handle=%#04x, status=%#04x", this->get_name().c_str(), param.handle, param.status);
+        this->record_failure(LatencyMetric::WRITE);
+        if (this->control_started_at_ != 0)
+          this->finish_control(false);
+        if (param.status == ESP_GATT_INVALID_HANDLE && this->handles_from_cache_)
+          this->invalidate_handle_cache();
+      }
       else
-        update();
+      {
+        // clock and schedule properties are null, unless configured
+        DeviceProperty *property = this->find_property(param.handle);
+        if (property == nullptr)
+          this->verify_write(param.handle);
+        else if (property == this->p_current_time)
+          ESP_LOGI(TAG, "[%s] device clock was synchronized", this->get_name().c_str());
+        else if (property == this->p_schedule_select)
+          this->queue_command(CommandType::READ, this->p_schedule_day); // day is read back, and written only if it differs
+        else if (property == this->p_schedule_day)
+          this->on_schedule_day_written();
+        else
+          this->verify_write(param.handle);
+      }
+    }
+
+    void Device::track_request(CommandType type, uint16_t handle)
+    {
+      if (!this->pending_.add(type, handle, millis() + this->request_timeout_))
+        ESP_LOGW(TAG, "[%s] too many pending requests, handle=%#04x is not tracked", this->get_name().c_str(), handle);
+    }
+
+    void Device::on_request_timeout(const PendingRequest &request)
+    {
+      this->request_timeouts_++;
+      if (this->request_timeouts_sensor_ != nullptr)
+        this->request_timeouts_sensor_->publish_state(this->request_timeouts_);
+
+      bool read = request.type == CommandType::READ;
+      this->record_failure(read ? LatencyMetric::READ : LatencyMetric::WRITE);
+      ESP_LOGW(TAG, "[%s] %s request timed out: handle=%#04x", this->get_name().c_str(), read ? "read" : "write", request.handle);
+
+      if (request.handle != INVALID_HANDLE)
+      {
+        DeviceProperty *property = this->find_property(request.handle);
+        if (property != nullptr)
+          this->retry_request(request.type, property);
+        return;
+      }
+
+      // read multiple responses are matched in order, so the expired one belongs to the oldest batch
+      if (this->batches_in_flight_ == 0)
+        return;
+
+      ReadBatch &batch = this->batches_[this->batch_head_];
+      this->batch_head_ = (this->batch_head_ + 1) % MAX_BATCHES_IN_FLIGHT;
+      this->batches_in_flight_--;
+      for (uint8_t i = 0; i < batch.size; i++)
+        this->retry_request(CommandType::READ, batch.properties[i]);
+    }
+
+    void Device::retry_request(CommandType type, DeviceProperty *property)
+    {
+      if (property->retries < this->request_retries_)
+      {
+        property->retries++;
+        this->queue_command(type, property);
+        return;
+      }
+
+      // session is closed once nothing is pending, the next poll starts over
+      ESP_LOGW(TAG, "[%s] giving up on handle=%#04x after %d retries", this->get_name().c_str(), property->handle, property->retries);
+      property->retries = 0;
+      if (type == CommandType::WRITE && this->control_started_at_ != 0)
+        this->finish_control(false);
+    }
+
+    DeviceProperty *Device::find_property(uint16_t handle)
+    {
+      if (handle < MAX_DISPATCH_HANDLE)
+      {
+        uint8_t slot = this->handle_slots_[handle];
+        return slot != 0 ? this->properties_[slot - 1] : nullptr;
+      }
+
+      for (uint8_t i = 0; i < this->property_count_; i++)
+        if (this->properties_[i]->handle == handle)
+          return this->properties_[i];
+      return nullptr;
+    }
+
+    void Device::verify_write(uint16_t handle)
+    {
+      WritableProperty *property = nullptr;
+      DeviceProperty *written = this->find_property(handle);
+      if (written == &this->p_temperature)
+        property = &this->p_temperature;
+      else if (written == &this->p_settings)
+        property = &this->p_settings;
+
+      if (property == nullptr)
+        return;
+
+      uint32_t now = millis();
+      this->record_latency(LatencyMetric::WRITE, now - property->requested_at);
+      if (this->control_started_at_ != 0 && !this->control_writes_pending())
+        this->finish_control(true);
+
+      // written data is published right away, verification read (if any) corrects it later
+      property->publish_state();
+
+      switch (property->verification)
+      {
+      case WriteVerification::NONE:
+        break;
+      case WriteVerification::READ_BACK:
+        this->queue_command(CommandType::READ, property);
+        break;
+      case WriteVerification::FULL_REFRESH:
+        this->request_state(); // connection is still open, re-read the state over it
+        break;
+      }
     }
 
     void Device::on_write_pin(esp_ble_gattc_cb_param_t::gattc_write_evt_param param)
     {
+      this->trace(ESP_GATTC_WRITE_CHAR_EVT, param.handle, param.status);
+      // wrong PIN is reported as a plain error, only the handle errors (or pin written into another characteristic) mean the cache is outdated
+      if ((param.status == ESP_GATT_INVALID_HANDLE || param.status == ESP_GATT_INVALID_ATTR_LEN) && this->handles_from_cache_)
+      {
+        // cached handles might be outdated, retry with the handles resolved by the service discovery
+        ESP_LOGW(TAG, "[%s] pin write with cached handles failed, status=%#04x, falling back to service discovery", this->get_name().c_str(), param.status);
+        this->invalidate_handle_cache();
+        if (this->search_complete_)
+        {
+          this->resolve_handles();
+          this->write_pin();
+        }
+        return; // otherwise pin is written once ESP_GATTC_SEARCH_CMPL_EVT arrives
+      }
+
       if (param.status != ESP_GATT_OK)
       {
         ESP_LOGE(TAG, "[%s] pin FAILED, status=%#04x", this->get_name().c_str(), param.status);
+        this->record_failure(LatencyMetric::PIN);
+        // wrong PIN is retried by the circuit breaker, so the fixed PIN does not require a reboot
+        this->record_connection_result(false);
         this->disconnect();
-        this->mark_failed();
         return;
       }
 
       ESP_LOGD(TAG, "[%s] pin OK", this->get_name().c_str());
+      this->cycle_timer_.mark(CyclePhase::PIN);
+      this->record_latency(LatencyMetric::PIN, this->cycle_timer_.duration(CyclePhase::PIN));
       this->node_state = ClientState::ESTABLISHED;
+      this->record_connection_result(true);
 
       // after PIN is written, we might need to read the secret_key from the device
-      if (this->xxtea->status() == XXTEA_STATUS_NOT_INITIALIZED && this->p_secret_key->handle != INVALID_HANDLE)
+      if (this->xxtea.status() == XXTEA_STATUS_NOT_INITIALIZED && this->p_secret_key.handle != INVALID_HANDLE)
       {
         ESP_LOGD(TAG, "[%s] attempting to read the device secret_key", this->get_name().c_str());
-        this->commands_.push(new Command(CommandType::READ, this->p_secret_key));
+        this->queue_command(CommandType::READ, &this->p_secret_key);
       }
     }
 
@@ -247,7 +804,7 @@ namespace esphome
         return;
       }
 
-      if (this->xxtea->status() == XXTEA_STATUS_NOT_INITIALIZED)
+      if (this->xxtea.status() == XXTEA_STATUS_NOT_INITIALIZED)
         ESP_LOGI(TAG, "[%s] Short press Danfoss Eco hardware button NOW in order to allow reading the secret key", this->get_name().c_str());
 
       if (!parent()->enabled)
@@ -255,10 +812,68 @@ namespace esphome
         ESP_LOGD(TAG, "[%s] re-enabling ble_client", this->get_name().c_str());
         parent()->set_enabled(true);
       }
-      
+
+      if (!this->cycle_timer_.is_running())
+        this->cycle_timer_.start();
+      this->attempt_in_progress_ = true;
+
+      BreakerState state = this->breaker_.state();
+      this->breaker_.record_attempt();
+      if (state != this->breaker_.state())
+      {
+        ESP_LOGI(TAG, "[%s] circuit breaker is half open, probing the device", this->get_name().c_str());
+        this->publish_breaker_state();
+      }
+
       this->parent()->connect(); // trigger BLE connection attempt
     }
 
+    void Device::request_secret_key()
+    {
+      if (this->xxtea.status() != XXTEA_STATUS_NOT_INITIALIZED)
+        return;
+
+      ESP_LOGI(TAG, "[%s] device is ready to share the secret key, connecting", this->get_name().c_str());
+      if (this->breaker_.state() != BreakerState::CLOSED || this->breaker_.failures() > 0)
+      {
+        this->breaker_.reset();
+        this->publish_breaker_state();
+      }
+      // secret key is read once the PIN is accepted
+      this->request_connection();
+    }
+
+    void Device::record_connection_result(bool success)
+    {
+      if (!this->attempt_in_progress_)
+        return;
+      this->attempt_in_progress_ = false;
+
+      BreakerState state = this->breaker_.state();
+      if (success)
+        this->breaker_.record_success();
+      else
+      {
+        uint32_t now = millis();
+        this->breaker_.record_failure(now);
+        ESP_LOGW(TAG, "[%s] connection failed (%d in a row), next attempt in %" PRIu32 "s",
+                 this->get_name().c_str(), this->breaker_.failures(), (this->breaker_.next_attempt() - now) / 1000);
+      }
+
+      if (state != this->breaker_.state())
+      {
+        ESP_LOGI(TAG, "[%s] circuit breaker: %s -> %s", this->get_name().c_str(),
+                 CircuitBreaker::state_to_string(state), CircuitBreaker::state_to_string(this->breaker_.state()));
+        this->publish_breaker_state();
+      }
+    }
+
+    void Device::publish_breaker_state()
+    {
+      if (this->breaker_state_ != nullptr)
+        this->breaker_state_->publish_state(CircuitBreaker::state_to_string(this->breaker_.state()));
+    }
+
     void Device::disconnect()
     {
       if (this->parent()->enabled)
@@ -267,6 +882,388 @@ namespace esphome
         this->parent()->set_enabled(false);
       }
       this->node_state = ClientState::IDLE;
+      this->lingering_ = false;
+
+      this->scheduler_->release(this);
+    }
+
+    PushResult Device::queue_command(CommandType type, DeviceProperty *property)
+    {
+      PushResult result = this->commands_.push(type, property);
+      if (result == PushResult::DROPPED)
+        ESP_LOGW(TAG, "[%s] command queue is full (%d entries), dropping command for handle=%#04x", this->get_name().c_str(), this->commands_.capacity(), property->handle);
+      return result;
+    }
+
+    void Device::adapt_update_interval()
+    {
+      if (!this->adaptive_polling_ || !this->p_temperature.has_data)
+        return;
+
+      float room = this->p_temperature.data.room_temperature;
+      float target = this->p_temperature.data.target_temperature;
+
+      if (!this->adaptive_tracking_)
+      {
+        this->adaptive_tracking_ = true;
+      }
+      else
+      {
+        // temperatures are reported in 0.5°C steps, so any decrease of the distance is a real movement
+        float distance = std::abs(target - room);
+        bool approaching = distance > 0 && distance < std::abs(this->last_target_temperature_ - this->last_room_temperature_);
+        bool action_flipped = this->action != this->last_action_;
+        bool unchanged = room == this->last_room_temperature_ && target == this->last_target_temperature_;
+
+        if (approaching || action_flipped)
+          this->apply_update_interval(this->min_interval_);
+        else if (unchanged)
+          this->apply_update_interval(std::min(this->get_update_interval() * 2, this->max_interval_));
+      }
+
+      this->last_room_temperature_ = room;
+      this->last_target_temperature_ = target;
+      this->last_action_ = this->action;
+    }
+
+    void Device::apply_update_interval(uint32_t interval)
+    {
+      if (interval == this->get_update_interval())
+        return;
+
+      ESP_LOGD(TAG, "[%s] update interval: %" PRIu32 "s -> %" PRIu32 "s", this->get_name().c_str(), this->get_update_interval() / 1000, interval / 1000);
+      this->set_update_interval(interval);
+      this->stop_poller();
+      this->start_poller();
+
+      if (this->effective_interval_ != nullptr)
+        this->effective_interval_->publish_state(interval / 1000.0f);
+    }
+
+    void Device::log_cycle_time()
+    {
+      ESP_LOGD(TAG, "[%s] cycle time: connect=%" PRIu32 " ms, discovery=%" PRIu32 " ms, pin=%" PRIu32 " ms, requests=%" PRIu32 " ms, disconnect=%" PRIu32 " ms, total=%" PRIu32 " ms",
+               this->get_name().c_str(),
+               this->cycle_timer_.duration(CyclePhase::CONNECT),
+               this->cycle_timer_.duration(CyclePhase::DISCOVERY),
+               this->cycle_timer_.duration(CyclePhase::PIN),
+               this->cycle_timer_.duration(CyclePhase::REQUESTS),
+               this->cycle_timer_.duration(CyclePhase::DISCONNECT),
+               this->cycle_timer_.total());
+    }
+
+    static const char *const LATENCY_METRIC_NAMES[LATENCY_METRIC_COUNT] = {"connect", "discovery", "pin", "read", "write", "disconnect", "control"};
+
+    void Device::dump_latency()
+    {
+      for (uint8_t i = 0; i < LATENCY_METRIC_COUNT; i++)
+      {
+        const LatencyHistogram &h = this->latency_[i];
+        if (h.successes() == 0 && h.failures() == 0)
+          continue;
+
+        ESP_LOGCONFIG(TAG, "  Latency %s: p50 %" PRIu32 " ms, p95 %" PRIu32 " ms, max %" PRIu32 " ms, ok %" PRIu32 ", failed %" PRIu32,
+                      LATENCY_METRIC_NAMES[i], h.percentile(50), h.percentile(95), h.max(), h.successes(), h.failures());
+      }
+    }
+
+    void Device::publish_latency()
+    {
+      for (uint8_t i = 0; i < LATENCY_METRIC_COUNT; i++)
+        for (uint8_t j = 0; j < LATENCY_STAT_COUNT; j++)
+          if (this->latency_sensors_[i][j] != nullptr)
+            this->latency_sensors_[i][j]->publish_state(this->latency_[i].value((LatencyStat)j));
+    }
+
+    void Device::resolve_handles()
+    {
+      for (uint8_t i = 0; i < this->property_count_; i++)
+        this->properties_[i]->init_handle(this->parent());
+
+      this->index_handles();
+      this->save_handle_cache();
+    }
+
+    void Device::index_handles()
+    {
+      memset(this->handle_slots_, 0, sizeof(this->handle_slots_));
+      for (uint8_t i = 0; i < this->property_count_; i++)
+      {
+        uint16_t handle = this->properties_[i]->handle;
+        if (handle < MAX_DISPATCH_HANDLE)
+          this->handle_slots_[handle] = i + 1;
+      }
+    }
+
+    void Device::load_handle_cache()
+    {
+      uint32_t hash = fnv1_hash("danfoss_eco_handles__" + this->parent()->address_str());
+      this->handles_pref_ = global_preferences->make_preference<HandleCacheValue>(hash, true);
+
+      this->handle_cache_valid_ = this->handles_pref_.load(&this->handle_cache_);
+      for (uint8_t i = 0; i < HANDLE_CACHE_SIZE && this->handle_cache_valid_; i++)
+        this->handle_cache_valid_ = this->handle_cache_.handles[i] != 0 && this->handle_cache_.handles[i] != INVALID_HANDLE;
+
+      if (this->handle_cache_valid_)
+        ESP_LOGD(TAG, "[%s] characteristic handles were loaded from flash", this->get_name().c_str());
+    }
+
+    bool Device::apply_handle_cache()
+    {
+      this->handles_from_cache_ = false;
+
+      // secret_key handle can only be resolved with the service discovery
+      if (!this->handle_cache_valid_ || this->xxtea.status() != XXTEA_STATUS_SUCCESS)
+        return false;
+
+      for (uint8_t i = 0; i < HANDLE_CACHE_SIZE; i++)
+        this->cached_properties_[i]->handle = this->handle_cache_.handles[i];
+      this->index_handles();
+
+      ESP_LOGD(TAG, "[%s] using cached characteristic handles", this->get_name().c_str());
+      this->handles_from_cache_ = true;
+      return true;
+    }
+
+    void Device::save_handle_cache()
+    {
+      HandleCacheValue value{};
+      for (uint8_t i = 0; i < HANDLE_CACHE_SIZE; i++)
+      {
+        value.handles[i] = this->cached_properties_[i]->handle;
+        if (value.handles[i] == INVALID_HANDLE)
+          return; // some characteristic was not resolved, nothing to cache
+      }
+
+      if (this->handle_cache_valid_ && memcmp(&value, &this->handle_cache_, sizeof(value)) == 0)
+        return;
+
+      this->handle_cache_ = value;
+      this->handle_cache_valid_ = this->handles_pref_.save(&this->handle_cache_);
+      ESP_LOGD(TAG, "[%s] characteristic handles were saved to flash", this->get_name().c_str());
+    }
+
+    void Device::restore_state()
+    {
+      uint32_t hash = fnv1_hash("danfoss_eco_state__" + this->get_name());
+      this->state_pref_ = global_preferences->make_preference<StateCacheValue>(hash, true);
+
+      if (!this->state_pref_.load(&this->state_cache_))
+        return;
+
+      // control() works with the restored data right away, device state replaces it on the first read
+      if (this->state_cache_.has_temperature)
+      {
+        this->p_temperature.data.target_temperature = this->state_cache_.target_temperature;
+        this->p_temperature.data.room_temperature = NAN; // unknown till the first read
+        this->p_temperature.has_data = true;
+        this->p_temperature.publish_state();
+      }
+      if (this->state_cache_.has_settings)
+      {
+        this->p_settings.data = this->state_cache_.settings;
+        this->p_settings.has_data = true;
+        this->p_settings.publish_state();
+      }
+
+      this->state_stale_ = this->state_cache_.has_temperature || this->state_cache_.has_settings;
+      if (this->state_stale_)
+        ESP_LOGI(TAG, "[%s] last known state was restored from flash (stale): target %2.1f°C, mode %d", this->get_name().c_str(),
+                 this->p_temperature.data.target_temperature, (int)this->p_settings.data.device_mode);
+    }
+
+    void Device::set_state_stale(bool stale)
+    {
+      if (this->state_stale_ == stale)
+        return;
+      this->state_stale_ = stale;
+      if (this->stale_ != nullptr)
+        this->stale_->publish_state(stale);
+    }
+
+    void Device::save_state()
+    {
+      // nothing new was read from the device
+      if (this->state_stale_ || (!this->p_temperature.has_data && !this->p_settings.has_data))
+        return;
+
+      StateCacheValue value{};
+      value.target_temperature = this->p_temperature.data.target_temperature;
+      value.settings = this->p_settings.data;
+      value.has_temperature = this->p_temperature.has_data;
+      value.has_settings = this->p_settings.has_data;
+
+      // flash is written only when the setpoint or the settings change, writes are batched by the preferences backend (no sync() here)
+      if (memcmp(&value, &this->state_cache_, sizeof(value)) == 0)
+        return;
+
+      this->state_cache_ = value;
+      this->state_pref_.save(&this->state_cache_);
+    }
+
+    void Device::resolve_optional_handles()
+    {
+      // these handles are not cached, as the characteristics are not used by every configuration
+      if (this->clock_enabled() && this->p_current_time->handle == INVALID_HANDLE)
+      {
+        if (this->p_current_time->init_handle(this->parent()))
+          this->queue_command(CommandType::READ, this->p_current_time);
+      }
+      if (this->schedule_enabled())
+      {
+        this->p_schedule_select->init_handle(this->parent());
+        this->p_schedule_day->init_handle(this->parent());
+      }
+      this->index_handles();
+    }
+
+    bool Device::optional_handles_pending()
+    {
+      if (this->search_complete_)
+        return false;
+
+      return (this->clock_enabled() && this->p_current_time->handle == INVALID_HANDLE) ||
+             (this->schedule_enabled() && this->p_schedule_select->handle == INVALID_HANDLE);
+    }
+
+    bool Device::sync_clock()
+    {
+#ifdef USE_TIME
+      if (!this->clock_enabled() || !this->p_current_time->has_data || this->clock_synced_ ||
+          this->p_current_time->handle == INVALID_HANDLE || this->xxtea.status() != XXTEA_STATUS_SUCCESS)
+        return false;
+
+      ESPTime now = this->time_->utcnow();
+      if (!now.is_valid())
+        return false;
+
+      // device time was read when requested, response arrives within a fraction of a second
+      time_t device_now = this->p_current_time->data.utc() + (millis() - this->p_current_time->requested_at) / 1000;
+      int32_t drift = (int32_t)(device_now - now.timestamp);
+      bool invalid_time = this->p_errors.has_data && this->p_errors.data.E10_INVALID_TIME;
+      if (!invalid_time && (uint32_t)std::abs(drift) <= this->clock_drift_threshold_)
+        return false;
+
+      ESP_LOGI(TAG, "[%s] device clock drift is %d s%s, synchronizing", this->get_name().c_str(), (int)drift, invalid_time ? " (E10)" : "");
+      int32_t offset = ESPTime::timezone_offset();
+      this->p_current_time->data.time_offset = offset;
+      this->p_current_time->data.time_local = now.timestamp + offset;
+      // the write makes the cached read stale, device time is read again on the next poll
+      this->p_current_time->has_data = false;
+      this->clock_synced_ = true;
+      this->queue_command(CommandType::WRITE, this->p_current_time);
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    void Device::load_schedule_cache()
+    {
+      uint32_t hash = fnv1_hash("danfoss_eco_schedule__" + this->get_name());
+      this->schedule_pref_ = global_preferences->make_preference<ScheduleCacheValue>(hash, true);
+
+      if (!this->schedule_pref_.load(&this->schedule_cache_))
+        this->schedule_cache_.days = 0; // nothing is known, all the managed days are checked
+
+      ESP_LOGD(TAG, "[%s] schedule days to be checked: %#04x", this->get_name().c_str(), this->schedule_changes());
+    }
+
+    uint8_t Device::schedule_changes()
+    {
+      uint8_t changes = 0;
+      for (uint8_t day = 0; day < ScheduleData::DAYS; day++)
+      {
+        uint8_t bit = 1 << day;
+        if ((this->schedule_days_ & bit) == 0)
+          continue;
+        if ((this->schedule_cache_.days & bit) == 0 || !this->schedule_.days[day].same_as(this->schedule_cache_.schedule.days[day]))
+          changes |= bit;
+      }
+      return changes;
+    }
+
+    bool Device::send_next_schedule_day()
+    {
+      if (!this->schedule_enabled() || this->xxtea.status() != XXTEA_STATUS_SUCCESS ||
+          this->p_schedule_select->handle == INVALID_HANDLE || this->p_schedule_day->handle == INVALID_HANDLE)
+        return false;
+
+      // days, which differ from the cached copy, are checked; the ones differing on the device are reported once per boot
+      uint8_t changes = this->schedule_changes() & ~(this->schedule_attempted_ | this->schedule_mismatches_);
+      if (changes == 0)
+        return false;
+
+      uint8_t day = 0;
+      while ((changes & (1 << day)) == 0)
+        day++;
+
+      ESP_LOGD(TAG, "[%s] checking schedule of day %d", this->get_name().c_str(), day);
+      this->schedule_attempted_ |= 1 << day;
+      this->schedule_writing_ = day;
+      this->p_schedule_select->day = day;
+      // periods are read (and written) once the day selection is acknowledged, so they never come from a wrong day
+      this->queue_command(CommandType::WRITE, this->p_schedule_select);
+      return true;
+    }
+
+    void Device::on_schedule_day_read()
+    {
+      if (this->schedule_writing_ < 0)
+        return;
+
+      uint8_t day = this->schedule_writing_;
+      if (this->p_schedule_day->data.same_as(this->schedule_.days[day]))
+      {
+        ESP_LOGD(TAG, "[%s] schedule of day %d is up to date", this->get_name().c_str(), day);
+        this->schedule_writing_ = -1;
+        this->cache_schedule_day(day);
+        return;
+      }
+
+      if (!this->write_schedule_)
+      {
+        ESP_LOGW(TAG, "[%s] schedule of day %d differs from the config, it is not written (write_schedule is off)", this->get_name().c_str(), day);
+        this->schedule_writing_ = -1;
+        this->schedule_mismatches_ |= 1 << day;
+        return;
+      }
+
+      ESP_LOGD(TAG, "[%s] writing schedule of day %d", this->get_name().c_str(), day);
+      this->p_schedule_day->data = this->schedule_.days[day];
+      this->queue_command(CommandType::WRITE, this->p_schedule_day);
+    }
+
+    void Device::on_schedule_day_written()
+    {
+      if (this->schedule_writing_ < 0)
+        return;
+
+      uint8_t day = this->schedule_writing_;
+      this->schedule_writing_ = -1;
+      this->cache_schedule_day(day);
+      ESP_LOGI(TAG, "[%s] schedule of day %d was written", this->get_name().c_str(), day);
+    }
+
+    void Device::cache_schedule_day(uint8_t day)
+    {
+      this->schedule_cache_.schedule.days[day] = this->schedule_.days[day];
+      this->schedule_cache_.days |= 1 << day;
+      this->schedule_pref_.save(&this->schedule_cache_);
+    }
+
+    void Device::invalidate_handle_cache()
+    {
+      ESP_LOGW(TAG, "[%s] invalidating cached characteristic handles", this->get_name().c_str());
+
+      this->handles_from_cache_ = false;
+      // nothing valid is stored, flash write is spared
+      if (!this->handle_cache_valid_)
+        return;
+
+      this->handle_cache_valid_ = false;
+      this->handle_cache_ = HandleCacheValue{};
+      this->handles_pref_.save(&this->handle_cache_);
     }
 
     void Device::set_pin_code(const string &str)
@@ -302,11 +1299,11 @@ namespace esphome
       }
     }
 
-    void Device::set_secret_key(uint8_t *key, bool persist)
+    void Device::set_secret_key(const uint8_t *key, bool persist)
     {
       ESP_LOGD(TAG, "[%s] secret_key bytes: %s", this->get_name().c_str(), format_hex_pretty(key, SECRET_KEY_LENGTH).c_str());
 
-      int status = this->xxtea->set_key(key, SECRET_KEY_LENGTH);
+      int status = this->xxtea.set_key(key, SECRET_KEY_LENGTH);
       if (status != XXTEA_STATUS_SUCCESS)
       {
         ESP_LOGE(TAG, "xxtea initialization failed, status: %d", status);
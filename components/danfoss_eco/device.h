@@ -2,18 +2,29 @@
 
 #include "esphome/components/ble_client/ble_client.h"
 #include "esphome/components/climate/climate.h"
+#include "esphome/components/text_sensor/text_sensor.h"
+#ifdef USE_TIME
+#include "esphome/components/time/real_time_clock.h"
+#endif
 
 #include "esphome/core/preferences.h"
 
 #include "helpers.h"
+#include "circuit_breaker.h"
 #include "command.h"
+#include "cycle_timer.h"
+#include "latency_histogram.h"
 #include "properties.h"
 #include "my_component.h"
+#include "scheduler.h"
 #include "xxtea.h"
 
 #ifdef USE_ESP32
 
 #include <esp_gattc_api.h>
+#include <esp_gap_ble_api.h>
+#include <cinttypes>
+#include <cmath>
 
 namespace esphome
 {
@@ -22,11 +33,9 @@ namespace esphome
     using namespace std;
     using namespace climate;
 
-    class Device : public MyComponent, public esphome::ble_client::BLEClientNode
+    class Device : public MyComponent, public esphome::ble_client::BLEClientNode, public esphome::esp32_ble_tracker::ESPBTDeviceListener
     {
     public:
-      Device() : xxtea(make_shared<Xxtea>()){};
-
       void dump_config() override
       {
         LOG_CLIMATE("", "Danfoss Eco eTRV", this);
@@ -34,47 +43,346 @@ namespace esphome
         LOG_SENSOR("", "Battery Level", this->battery_level_);
         LOG_SENSOR("", "Room Temperature", this->temperature_);
         LOG_BINARY_SENSOR("", "Problems", this->problems_);
+        ESP_LOGCONFIG(TAG, "  Command Queue: high water mark %d/%d, merged %" PRIu32 ", dropped %" PRIu32,
+                      this->commands_.high_water_mark(), this->commands_.capacity(), this->commands_.merged(), this->commands_.dropped());
+        ESP_LOGCONFIG(TAG, "  Command Latency: avg %" PRIu32 " ms, max %" PRIu32 " ms", this->commands_.avg_latency(), this->commands_.max_latency());
+        ESP_LOGCONFIG(TAG, "  Read Multiple: %s", YESNO(this->read_multiple_supported_));
+        if (this->schedule_enabled())
+          ESP_LOGCONFIG(TAG, "  Schedule: days %#04x, %#04x to be checked, %#04x differ, writes %s", this->schedule_days_, this->schedule_changes(),
+                        this->schedule_mismatches_, this->write_schedule_ ? "enabled" : "disabled");
+        if (this->state_stale_)
+          ESP_LOGCONFIG(TAG, "  State: restored from flash, not confirmed by the device yet");
+        LOG_BINARY_SENSOR("", "Stale", this->stale_);
+        ESP_LOGCONFIG(TAG, "  Write Debounce: %" PRIu32 " ms, coalesced %" PRIu32 " writes", this->write_debounce_, this->coalesced_writes_);
+        ESP_LOGCONFIG(TAG, "  Request Timeout: %" PRIu32 " ms, %d retries, timed out %" PRIu32 " requests", this->request_timeout_, this->request_retries_, this->request_timeouts_);
+        LOG_SENSOR("", "Request Timeouts", this->request_timeouts_sensor_);
+        ESP_LOGCONFIG(TAG, "  Write Verification: target temperature %d, mode %d", (int)this->temperature_verification_, (int)this->mode_verification_);
+        if (this->conn_params_configured_)
+          ESP_LOGCONFIG(TAG, "  Connection Parameters: interval %.2f - %.2f ms, latency %d, timeout %d ms",
+                        this->conn_params_.min_int * 1.25f, this->conn_params_.max_int * 1.25f, this->conn_params_.latency, this->conn_params_.timeout * 10);
+        if (this->conn_interval_ != 0)
+          ESP_LOGCONFIG(TAG, "  Negotiated Connection: interval %.2f ms, latency %d, timeout %d ms",
+                        this->conn_interval_ * 1.25f, this->conn_latency_, this->conn_timeout_ * 10);
+        if (this->session_linger_ > 0)
+          ESP_LOGCONFIG(TAG, "  Session Linger: %" PRIu32 " ms", this->session_linger_);
+        if (this->advertisement_seen_)
+          ESP_LOGCONFIG(TAG, "  Last Advertisement: %" PRIu32 "s ago, RSSI %d dBm, flags %#04x",
+                        (millis() - this->last_seen_) / 1000, this->rssi_, this->advertisement_flags_);
+        if (this->adaptive_polling_)
+          ESP_LOGCONFIG(TAG, "  Adaptive Polling: %" PRIu32 "s - %" PRIu32 "s, current %" PRIu32 "s",
+                        this->min_interval_ / 1000, this->max_interval_ / 1000, this->get_update_interval() / 1000);
+        LOG_SENSOR("", "Effective Interval", this->effective_interval_);
+        if (this->cycle_timer_.cycles() > 0)
+          ESP_LOGCONFIG(TAG, "  Last Cycle Time: %" PRIu32 " ms (%" PRIu32 " cycles)", this->cycle_timer_.total(), this->cycle_timer_.cycles());
+        ESP_LOGCONFIG(TAG, "  Circuit Breaker: %s, %d consecutive failures", CircuitBreaker::state_to_string(this->breaker_.state()), this->breaker_.failures());
+        LOG_TEXT_SENSOR("", "Breaker State", this->breaker_state_);
+        this->dump_latency();
+        // sizes of the fixed structures only, buffers of ESPHome and the BLE stack are not included
+        ESP_LOGCONFIG(TAG, "  Object Sizes: device %u bytes, scheduler entry %u bytes, optional properties %u bytes (%d properties)",
+                      (unsigned)sizeof(Device), (unsigned)ConnectionScheduler::entry_size(), (unsigned)this->optional_properties_size(),
+                      this->property_count_);
       }
 
+      void dump_latency();
+
       void setup() override;
       void loop() override;
       void update() override;
       void gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param) override;
+      void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) override;
+      bool parse_device(const esphome::esp32_ble_tracker::ESPBTDevice &device) override;
 
-      void set_secret_key(uint8_t *, bool) override;
+      void set_secret_key(const uint8_t *, bool) override;
+      bool write_outstanding(const WritableProperty *) override;
 
       void set_secret_key(const string &);
       void set_pin_code(const string &);
+      void set_scheduler(ConnectionScheduler *scheduler, uint8_t index)
+      {
+        this->scheduler_ = scheduler;
+        this->index_ = index;
+      }
+      void set_adaptive_polling(uint32_t min_interval, uint32_t max_interval)
+      {
+        this->adaptive_polling_ = true;
+        this->min_interval_ = min_interval;
+        this->max_interval_ = max_interval;
+      }
+      void set_effective_interval(Sensor *effective_interval) { this->effective_interval_ = effective_interval; }
+      void set_latency_sensor(LatencyMetric metric, LatencyStat stat, Sensor *sensor) { this->latency_sensors_[(uint8_t)metric][(uint8_t)stat] = sensor; }
+      void set_circuit_breaker(uint8_t failure_threshold, uint32_t initial_backoff, uint32_t max_backoff)
+      {
+        this->breaker_.set_failure_threshold(failure_threshold);
+        this->breaker_.set_backoff(initial_backoff, max_backoff);
+      }
+      void set_breaker_state(text_sensor::TextSensor *breaker_state) { this->breaker_state_ = breaker_state; }
+      void set_stale(BinarySensor *stale) { this->stale_ = stale; }
+      // days without periods are kept at the economy temperature, days which were never added are not managed
+      void add_schedule_day(uint8_t day)
+      {
+        this->schedule_days_ |= 1 << day;
+        this->schedule_.days[day].count = 0;
+      }
+      void add_schedule_period(uint8_t day, uint8_t start, uint8_t end)
+      {
+        ScheduleDayData &d = this->schedule_.days[day];
+        if (d.count == ScheduleDayData::MAX_PERIODS)
+          return;
+        d.starts[d.count] = start;
+        d.ends[d.count] = end;
+        d.count++;
+      }
+      // schedule characteristics are not documented, so the days are only compared with the config, unless enabled
+      void set_write_schedule(bool write_schedule) { this->write_schedule_ = write_schedule; }
+#ifdef USE_TIME
+      void set_time(time::RealTimeClock *time) { this->time_ = time; }
+#endif
+      void set_clock_drift_threshold(uint32_t threshold) { this->clock_drift_threshold_ = threshold; }
+      // in BLE units: intervals in 1.25 ms steps, supervision timeout in 10 ms steps
+      void set_connection_parameters(uint16_t min_interval, uint16_t max_interval, uint16_t latency, uint16_t timeout)
+      {
+        this->conn_params_configured_ = true;
+        this->conn_params_.min_int = min_interval;
+        this->conn_params_.max_int = max_interval;
+        this->conn_params_.latency = latency;
+        this->conn_params_.timeout = timeout;
+      }
+      void set_session_linger(uint32_t session_linger) { this->session_linger_ = session_linger; }
+      void set_write_debounce(uint32_t write_debounce) { this->write_debounce_ = write_debounce; }
+      void set_request_timeout(uint32_t timeout, uint8_t retries)
+      {
+        this->request_timeout_ = timeout;
+        this->request_retries_ = retries;
+      }
+      void set_request_timeouts(Sensor *request_timeouts) { this->request_timeouts_sensor_ = request_timeouts; }
+      void set_temperature_verification(WriteVerification verification) { this->temperature_verification_ = verification; }
+      void set_mode_verification(WriteVerification verification) { this->mode_verification_ = verification; }
 
-    protected:
-      void control(const ClimateCall &call) override;
+      // applies the setpoint of a group operation, the result is reported to the scheduler once the writes are acknowledged
+      GroupApply apply_group_command(const GroupCommand &command);
 
+      // connection slots are handed out by ConnectionScheduler, use request_connection() instead of calling connect() directly
       void connect();
       void disconnect();
+      bool is_established() const { return this->node_state == ClientState::ESTABLISHED; }
+
+      // connects right away, if the secret key is still unknown, so it is read while the device allows that
+      void request_secret_key();
+
+      // returns false, while the failed device is backing off or its circuit breaker is open
+      // (no side effects, the scheduler asks every queued device; the granted one is moved to half open by connect())
+      bool may_connect(uint32_t now) const { return this->breaker_.would_allow(now); }
+      // result of the latest connect(), connection is successful once the PIN is accepted
+      void record_connection_result(bool success);
+
+      // device is considered reachable, if it has advertised within the timeout (or since boot, if it was never seen)
+      bool is_reachable(uint32_t now, uint32_t timeout) const
+      {
+        return this->advertisement_seen_ ? now - this->last_seen_ < timeout : now < timeout;
+      }
+      int rssi() const { return this->advertisement_seen_ ? this->rssi_ : -127; }
+      uint32_t last_seen() const { return this->last_seen_; }
+
+    protected:
+      void control(const ClimateCall &call) override;
+
+      void request_connection();
+      void request_control_session();
+      PushResult queue_command(CommandType type, DeviceProperty *property);
+      void track_request(CommandType type, uint16_t handle);
+      void on_request_timeout(const PendingRequest &request);
+      void retry_request(CommandType type, DeviceProperty *property);
+      DeviceProperty *find_property(uint16_t handle);
+      void schedule_write(WritableProperty *property);
+      void verify_write(uint16_t handle);
+      void flush_pending_writes();
+      void request_state();
 
       void write_pin();
       void on_write_pin(esp_ble_gattc_cb_param_t::gattc_write_evt_param);
 
       void on_read(esp_ble_gattc_cb_param_t::gattc_read_char_evt_param);
+      void on_read_multiple(esp_ble_gattc_cb_param_t::gattc_read_char_evt_param);
+      void send_read_plan(const ReadPlan &plan);
+      void send_read_batch(ReadBatch &batch);
       void on_write(esp_ble_gattc_cb_param_t::gattc_write_evt_param);
 
-      shared_ptr<Xxtea> xxtea;
+      void log_cycle_time();
+      void record_latency(LatencyMetric metric, uint32_t latency) { this->latency_[(uint8_t)metric].record(latency); }
+      void record_failure(LatencyMetric metric) { this->latency_[(uint8_t)metric].record_failure(); }
+      void publish_latency();
+      void trace(esp_gattc_cb_event_t event, uint16_t handle, uint8_t status, const uint8_t *value = nullptr, uint16_t value_len = 0)
+      {
+        this->scheduler_->trace().record(this->index_, (uint8_t)event, handle, status, value, value_len);
+      }
+      void adapt_update_interval();
+      void apply_update_interval(uint32_t interval);
+      void publish_breaker_state();
+
+      void load_handle_cache();
+      bool apply_handle_cache();
+      void save_handle_cache();
+      void invalidate_handle_cache();
+
+      void restore_state();
+      void save_state();
+      void set_state_stale(bool stale);
+
+      void resolve_optional_handles();
+      bool optional_handles_pending();
+      bool sync_clock();
+
+      void load_schedule_cache();
+      uint8_t schedule_changes();
+      bool send_next_schedule_day();
+      void on_schedule_day_read();
+      void on_schedule_day_written();
+      void cache_schedule_day(uint8_t day);
+      void resolve_handles();
+      void index_handles();
+      bool control_writes_pending();
+      void finish_control(bool success);
+      void request_connection_parameters(const esp_bd_addr_t remote_bda);
+
+      void add_property(DeviceProperty *property) { this->properties_[this->property_count_++] = property; }
+      bool schedule_enabled() const { return this->schedule_days_ != 0; }
+      // heap used by the clock and schedule properties
+      size_t optional_properties_size() const
+      {
+        return (this->p_current_time != nullptr ? sizeof(CurrentTimeProperty) : 0) +
+               (this->p_schedule_select != nullptr ? sizeof(ScheduleDaySelectProperty) + sizeof(ScheduleDayProperty) : 0);
+      }
+      bool clock_enabled() const
+      {
+#ifdef USE_TIME
+        return this->time_ != nullptr;
+#else
+        return false;
+#endif
+      }
+
+      // declared before the properties, which keep a pointer to it
+      Xxtea xxtea;
 
-      shared_ptr<WritableProperty> p_pin{nullptr};
-      shared_ptr<BatteryProperty> p_battery{nullptr};
-      shared_ptr<TemperatureProperty> p_temperature{nullptr};
-      shared_ptr<SettingsProperty> p_settings{nullptr};
-      shared_ptr<ErrorsProperty> p_errors{nullptr};
-      shared_ptr<SecretKeyProperty> p_secret_key{nullptr};
+      // properties used by every configuration are embedded
+      WritableProperty p_pin{this, &this->xxtea, PropertyId::PIN};
+      BatteryProperty p_battery{this, &this->xxtea};
+      TemperatureProperty p_temperature{this, &this->xxtea};
+      SettingsProperty p_settings{this, &this->xxtea};
+      ErrorsProperty p_errors{this, &this->xxtea};
+      SecretKeyProperty p_secret_key{this, &this->xxtea};
+      // allocated once by setup(), only if the time source is configured
+      CurrentTimeProperty *p_current_time{nullptr};
+      // allocated once by setup(), only if the schedule is configured
+      ScheduleDaySelectProperty *p_schedule_select{nullptr};
+      ScheduleDayProperty *p_schedule_day{nullptr};
 
-      set<shared_ptr<DeviceProperty>> properties{nullptr};
+      // properties in use by the configuration, their handles are resolved on service discovery
+      DeviceProperty *properties_[PROPERTY_COUNT]{nullptr};
+      uint8_t property_count_{0};
+      // responses are dispatched by handle: index in properties_ + 1, 0 if the handle is unknown
+      // eTRV handles are below 0x40, larger ones (if any) are looked up in properties_
+      static constexpr uint16_t MAX_DISPATCH_HANDLE = 0x40;
+      uint8_t handle_slots_[MAX_DISPATCH_HANDLE]{0};
+      // properties with handles persisted in handles_pref_, in HandleCacheValue order
+      DeviceProperty *cached_properties_[HANDLE_CACHE_SIZE]{nullptr};
 
     private:
+      ConnectionScheduler *scheduler_{nullptr};
+      uint8_t index_{0}; // registration order, identifies the device in the event trace
       ESPPreferenceObject secret_pref_;
+      ESPPreferenceObject handles_pref_;
+      ESPPreferenceObject state_pref_;
+      StateCacheValue state_cache_{};
+      bool state_stale_{false}; // published state was restored from flash, and was not read from the device yet
+      BinarySensor *stale_{nullptr};
+
+#ifdef USE_TIME
+      time::RealTimeClock *time_{nullptr};
+#endif
+      uint32_t clock_drift_threshold_{60}; // seconds
+      bool clock_synced_{false};           // clock was written during the current session
+
+      // weekly schedule from the config, only the days, which differ from the cached copy are written
+      ScheduleData schedule_{};
+      uint8_t schedule_days_{0}; // bitmask of the managed days
+      ScheduleCacheValue schedule_cache_{};
+      ESPPreferenceObject schedule_pref_;
+      uint8_t schedule_attempted_{0};  // days checked during the current session, failed ones wait for the next one
+      uint8_t schedule_mismatches_{0}; // days, which differ on the device and are not written (write_schedule is off)
+      int8_t schedule_writing_{-1};    // day, which is being checked (and written)
+      bool write_schedule_{false};
+      HandleCacheValue handle_cache_{};
+      bool handle_cache_valid_{false};
+      bool handles_from_cache_{false}; // PIN was written using cached handles, before service discovery completed
+      bool search_complete_{false};
       uint32_t pin_code_ = 0;
 
-      uint8_t request_counter_ = 0;
+      // every request has a deadline, so a lost response can not keep the connection open forever
+      PendingRequests pending_;
+      uint32_t request_timeout_{5000};
+      uint8_t request_retries_{1};
+      uint32_t request_timeouts_{0};
+      Sensor *request_timeouts_sensor_{nullptr};
+
+      // keep the link open after control() till it has been idle for session_linger_
+      uint32_t session_linger_{0};
+      bool lingering_{false};
+      uint32_t last_activity_{0};
+
+      // writes of the same property within the window collapse into a single write of the latest value
+      uint32_t write_debounce_{0};
+      uint32_t coalesced_writes_{0};
+
+      WriteVerification temperature_verification_{WriteVerification::READ_BACK};
+      WriteVerification mode_verification_{WriteVerification::READ_BACK};
+
+      // requested right after the link is open, so the poll burst does not wait for the default (slow) interval
+      bool conn_params_configured_{false};
+      esp_ble_conn_update_params_t conn_params_{};
+      // latest parameters reported by the controller, in BLE units (0 - not reported yet)
+      uint16_t conn_interval_{0};
+      uint16_t conn_latency_{0};
+      uint16_t conn_timeout_{0};
+
+      // once the peer rejects a read multiple request, reads are sent one by one
+      bool read_multiple_supported_{true};
+      uint16_t mtu_{ESP_GATT_DEF_BLE_MTU_SIZE};
+      static constexpr uint8_t MAX_BATCHES_IN_FLIGHT = 4;
+      ReadBatch batches_[MAX_BATCHES_IN_FLIGHT];
+      uint8_t batch_head_{0};
+      uint8_t batches_in_flight_{0};
+
       CommandQueue commands_;
+      CycleTimer cycle_timer_;
+
+      // failed connection attempts are retried with exponential backoff, till the breaker opens
+      CircuitBreaker breaker_;
+      bool attempt_in_progress_{false}; // each connect() is counted once, either as success or failure
+      bool ble_client_disabled_{false}; // ble_client was taken over from its own reconnect logic
+      text_sensor::TextSensor *breaker_state_{nullptr};
+
+      LatencyHistogram latency_[LATENCY_METRIC_COUNT];
+      Sensor *latency_sensors_[LATENCY_METRIC_COUNT][LATENCY_STAT_COUNT]{};
+      uint32_t control_started_at_{0}; // first control() call, which is not acknowledged yet
+      bool group_pending_{false};      // control in progress was started by a group operation
+
+      // adaptive polling shortens update_interval, while room temperature is moving towards the target
+      // and backs off exponentially, while nothing changes
+      bool adaptive_polling_{false};
+      uint32_t min_interval_{0};
+      uint32_t max_interval_{0};
+      bool adaptive_tracking_{false}; // last_* values below are known
+      float last_room_temperature_{NAN};
+      float last_target_temperature_{NAN};
+      ClimateAction last_action_{ClimateAction::CLIMATE_ACTION_OFF};
+      Sensor *effective_interval_{nullptr};
+
+      // latest advertisement, received from the device
+      bool advertisement_seen_{false};
+      uint32_t last_seen_{0};
+      int rssi_{0};
+      uint8_t advertisement_flags_{0}; // first char of the advertised name, see DanfossEcoScanner::parse_device
     };
 
   } // namespace danfoss_eco
@@ -3,7 +3,8 @@
 #include "esphome/core/log.h"
 
 #include "helpers.h"
-#include "xxtea.h"
+
+#include <cmath>
 
 namespace esphome
 {
@@ -12,49 +13,34 @@ namespace esphome
         using namespace std;
         using namespace climate;
 
-        struct DeviceData
-        {
-            uint16_t length;
-
-            DeviceData(uint16_t l, shared_ptr<Xxtea> &xxtea) : length(l), xxtea_(xxtea) {}
-            virtual ~DeviceData()
-            {
-            }
-
-        protected:
-            shared_ptr<Xxtea> xxtea_;
-        };
+        // Decoded characteristic values are plain structs, embedded into the properties.
+        // They work with decrypted buffers only, encryption is up to the property.
 
-        struct WritableData : public DeviceData
+        struct TemperatureData
         {
-            WritableData(uint16_t l, shared_ptr<Xxtea> &xxtea) : DeviceData(l, xxtea) {}
-            virtual void pack(uint8_t *) = 0;
-        };
+            static constexpr uint16_t LENGTH = 8;
 
-        struct TemperatureData : public WritableData
-        {
             float target_temperature;
             float room_temperature;
 
-            TemperatureData(shared_ptr<Xxtea> &xxtea, uint8_t *raw_data, uint16_t value_len) : WritableData(8, xxtea)
+            void unpack(const uint8_t *temperatures)
             {
-                uint8_t *temperatures = decrypt(this->xxtea_, raw_data, value_len);
-                
                 this->target_temperature = temperatures[0] / 2.0f;
                 this->room_temperature = temperatures[1] / 2.0f;
             }
 
-            void pack(uint8_t *buff)
+            void pack(uint8_t *buff) const
             {
                 buff[0] = (uint8_t)(target_temperature * 2);
-                buff[1] = (uint8_t)(room_temperature * 2);
-
-                encrypt(this->xxtea_, buff, length);
+                // room temperature is unknown (NAN) after the state is restored from flash
+                buff[1] = std::isnan(room_temperature) ? 0 : (uint8_t)(room_temperature * 2);
             }
         };
 
-        struct SettingsData : public WritableData
+        struct SettingsData
         {
+            static constexpr uint16_t LENGTH = 16;
+
             enum DeviceMode
             {
                 MANUAL = 0,
@@ -87,12 +73,9 @@ namespace esphome
             time_t vacation_from; // utc
             time_t vacation_to;   // utc
 
-            SettingsData(shared_ptr<Xxtea> &xxtea, uint8_t *raw_data, uint16_t value_len) : WritableData(16, xxtea)
+            void unpack(const uint8_t *settings)
             {
-                uint8_t *settings = decrypt(this->xxtea_, raw_data, value_len);
-
-                this->settings_ = (uint8_t *)malloc(length);
-                memcpy(this->settings_, (const char *)settings, length);
+                memcpy(this->settings_, settings, LENGTH);
 
                 this->temperature_min = settings[1] / 2.0f;
                 this->temperature_max = settings[2] / 2.0f;
@@ -104,9 +87,7 @@ namespace esphome
                 this->vacation_to = parse_int(settings, 10);
             }
 
-            ~SettingsData() { free(this->settings_); }
-
-            ClimateMode to_climate_mode(DeviceMode mode)
+            static ClimateMode to_climate_mode(DeviceMode mode)
             {
                 switch (mode)
                 {
@@ -124,9 +105,9 @@ namespace esphome
                 }
             }
 
-            void pack(uint8_t *buff)
+            void pack(uint8_t *buff) const
             {
-                memcpy(buff, (const char *)this->settings_, length);
+                memcpy(buff, this->settings_, LENGTH);
 
                 buff[1] = (uint8_t)(this->temperature_min * 2);
                 buff[2] = (uint8_t)(this->temperature_max * 2);
@@ -139,26 +120,26 @@ namespace esphome
 
                 write_int(buff, 6, this->vacation_from);
                 write_int(buff, 10, this->vacation_to);
-
-                encrypt(this->xxtea_, buff, length);  // length = 16, not 8!
             }
 
         private:
-            uint8_t *settings_;
+            uint8_t settings_[LENGTH]; // raw settings, to keep the fields which are not decoded
         };
 
-        struct ErrorsData : public DeviceData
+        struct ErrorsData
         {
+            static constexpr uint16_t LENGTH = 8;
+
             bool E9_VALVE_DOES_NOT_CLOSE;
             bool E10_INVALID_TIME;
             bool E14_LOW_BATTERY;
             bool E15_VERY_LOW_BATTERY;
 
-            ErrorsData(shared_ptr<Xxtea> &xxtea, uint8_t *raw_data, uint16_t value_len) : DeviceData(8, xxtea)
+            void unpack(const uint8_t *data)
             {
                 // unsigned short error;
                 // unsigned char padding[6];
-                uint16_t errors = parse_short(decrypt(this->xxtea_, raw_data, value_len), 0);
+                uint16_t errors = parse_short(data, 0);
 
                 E9_VALVE_DOES_NOT_CLOSE = parse_bit(errors, 8);
                 E10_INVALID_TIME = parse_bit(errors, 9);
@@ -167,5 +148,80 @@ namespace esphome
             }
         };
 
+        struct CurrentTimeData
+        {
+            static constexpr uint16_t LENGTH = 8;
+
+            int32_t time_local;  // local time of the device, seconds since epoch
+            int32_t time_offset; // offset of the local time from UTC, seconds
+
+            void unpack(const uint8_t *data)
+            {
+                this->time_local = parse_int(data, 0);
+                this->time_offset = parse_int(data, 4);
+            }
+
+            void pack(uint8_t *buff) const
+            {
+                write_int(buff, 0, this->time_local);
+                write_int(buff, 4, this->time_offset);
+            }
+
+            time_t utc() const { return this->time_local - this->time_offset; }
+        };
+
+        // Heating periods of a single day, outside of them the eTRV keeps the economy temperature.
+        // NOTE: the layout is not documented by Danfoss, see "Weekly schedule" in README.
+        struct ScheduleDayData
+        {
+            static constexpr uint16_t LENGTH = 8;
+            static constexpr uint8_t MAX_PERIODS = 3;
+            static constexpr uint8_t UNUSED = 0xFF;
+
+            // start and end of the periods, in 30 minute steps since midnight
+            uint8_t starts[MAX_PERIODS];
+            uint8_t ends[MAX_PERIODS];
+            uint8_t count;
+
+            void unpack(const uint8_t *data)
+            {
+                this->count = 0;
+                for (uint8_t i = 0; i < MAX_PERIODS; i++)
+                {
+                    if (data[i * 2] == UNUSED)
+                        break;
+                    this->starts[i] = data[i * 2];
+                    this->ends[i] = data[i * 2 + 1];
+                    this->count++;
+                }
+            }
+
+            void pack(uint8_t *buff) const
+            {
+                memset(buff, 0, LENGTH);
+                for (uint8_t i = 0; i < MAX_PERIODS; i++)
+                {
+                    buff[i * 2] = i < this->count ? this->starts[i] : UNUSED;
+                    buff[i * 2 + 1] = i < this->count ? this->ends[i] : UNUSED;
+                }
+            }
+
+            // compares the packed values, so unused periods do not matter
+            bool same_as(const ScheduleDayData &other) const
+            {
+                uint8_t a[LENGTH], b[LENGTH];
+                this->pack(a);
+                other.pack(b);
+                return memcmp(a, b, LENGTH) == 0;
+            }
+        };
+
+        struct ScheduleData
+        {
+            static constexpr uint8_t DAYS = 7; // monday first
+
+            ScheduleDayData days[DAYS];
+        };
+
     } // namespace danfoss_eco
 } // namespace esphome
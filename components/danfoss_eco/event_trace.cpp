@@ -0,0 +1,32 @@
+#include "esphome/core/log.h"
+
+#include <cinttypes>
+
+#include "event_trace.h"
+#include "helpers.h"
+
+namespace esphome
+{
+    namespace danfoss_eco
+    {
+        static const char *const TRACE_TAG = "danfoss_eco.trace";
+
+        void EventTrace::dump()
+        {
+            ESP_LOGI(TRACE_TAG, "GATT event trace, %d events:", this->size_);
+
+            uint8_t first = (this->head_ + TRACE_SIZE - this->size_) % TRACE_SIZE;
+            for (uint8_t i = 0; i < this->size_; i++)
+            {
+                const TraceEvent &event = this->events_[(first + i) % TRACE_SIZE];
+
+                char payload[TraceEvent::PAYLOAD_SIZE * 2 + 1]{0};
+                encode_hex(event.payload, event.length < TraceEvent::PAYLOAD_SIZE ? event.length : TraceEvent::PAYLOAD_SIZE, payload);
+
+                ESP_LOGI(TRACE_TAG, "  %" PRIu32 " dev=%d event=%d handle=%#04x status=%#04x len=%d data=%s",
+                         event.timestamp, event.device, event.type, event.handle, event.status, event.length, payload);
+            }
+        }
+
+    } // namespace danfoss_eco
+} // namespace esphome
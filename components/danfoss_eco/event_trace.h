@@ -0,0 +1,61 @@
+#pragma once
+
+#include "esphome/core/hal.h"
+
+#include <cstring>
+
+namespace esphome
+{
+    namespace danfoss_eco
+    {
+        // Compact binary record of a single GATT event, formatting is postponed till the trace is dumped
+        struct TraceEvent
+        {
+            static constexpr uint8_t PAYLOAD_SIZE = 8;
+
+            uint32_t timestamp; // millis()
+            uint16_t handle;
+            uint8_t device; // index of the device in the order of registration
+            uint8_t type;   // esp_gattc_cb_event_t
+            uint8_t status; // esp_gatt_status_t
+            uint8_t length; // full length of the value, only first PAYLOAD_SIZE bytes are kept
+            uint8_t payload[PAYLOAD_SIZE];
+        };
+
+        // Fixed-size ring of the latest GATT events of all the devices, oldest events are overwritten.
+        // Recording is a copy of ~20 bytes, so the trace can stay enabled on production gateways.
+        class EventTrace
+        {
+        public:
+            static constexpr uint8_t TRACE_SIZE = 128;
+
+            void record(uint8_t device, uint8_t type, uint16_t handle, uint8_t status, const uint8_t *value = nullptr, uint16_t value_len = 0)
+            {
+                TraceEvent &event = this->events_[this->head_];
+                event.timestamp = millis();
+                event.handle = handle;
+                event.device = device;
+                event.type = type;
+                event.status = status;
+                event.length = value_len > UINT8_MAX ? UINT8_MAX : value_len;
+                uint8_t payload_len = value_len < TraceEvent::PAYLOAD_SIZE ? value_len : TraceEvent::PAYLOAD_SIZE;
+                if (payload_len > 0)
+                    memcpy(event.payload, value, payload_len);
+
+                this->head_ = (this->head_ + 1) % TRACE_SIZE;
+                if (this->size_ < TRACE_SIZE)
+                    this->size_++;
+            }
+
+            // logs recorded events, oldest first
+            void dump();
+            void clear() { this->size_ = 0; }
+
+        protected:
+            TraceEvent events_[TRACE_SIZE];
+            uint8_t head_{0};
+            uint8_t size_{0};
+        };
+
+    } // namespace danfoss_eco
+} // namespace esphome
@@ -33,12 +33,12 @@ namespace esphome
                 buff[i] = (parse_hex(data[i * 2]).value() << 4) | parse_hex(data[i * 2 + 1]).value();
         }
 
-        uint32_t parse_int(uint8_t *data, int start_pos)
+        uint32_t parse_int(const uint8_t *data, int start_pos)
         {
             return int(data[start_pos] << 24 | data[start_pos + 1] << 16 | data[start_pos + 2] << 8 | data[start_pos + 3]);
         }
 
-        uint16_t parse_short(uint8_t *data, int start_pos)
+        uint16_t parse_short(const uint8_t *data, int start_pos)
         {
             return short(data[start_pos] << 8 | data[start_pos + 1]);
         }
@@ -60,7 +60,7 @@ namespace esphome
             data ^= (-value ^ data) & (1UL << pos);
         }
 
-        void reverse_chunks(uint8_t *data, int len, uint8_t *reversed_buff)
+        void reverse_chunks(const uint8_t *data, int len, uint8_t *reversed_buff)
         {
             for (int i = 0; i < len; i += 4)
             {
@@ -72,22 +72,36 @@ namespace esphome
             }
         }
 
-        uint8_t *encrypt(shared_ptr<Xxtea> &xxtea, uint8_t *value, uint16_t value_len)
+        void encrypt(Xxtea &xxtea, uint8_t *value, uint16_t value_len)
         {
-            uint8_t buffer[value_len];
+            switch (value_len)
+            {
+            case 8:
+                return xxtea.encrypt_be<2>(value, value);
+            case 16:
+                return xxtea.encrypt_be<4>(value, value);
+            }
+
+            uint8_t buffer[MAX_ENCRYPTED_LENGTH];
             reverse_chunks(value, value_len, buffer);
-            xxtea->encrypt(buffer, value_len);
+            xxtea.encrypt(buffer, value_len);
             reverse_chunks(buffer, value_len, value);
-            return value;
         }
 
-        uint8_t *decrypt(shared_ptr<Xxtea> &xxtea, uint8_t *value, uint16_t value_len)
+        void decrypt(Xxtea &xxtea, const uint8_t *value, uint16_t value_len, uint8_t *plain)
         {
-            uint8_t buffer[value_len];
+            switch (value_len)
+            {
+            case 8:
+                return xxtea.decrypt_be<2>(value, plain);
+            case 16:
+                return xxtea.decrypt_be<4>(value, plain);
+            }
+
+            uint8_t buffer[MAX_ENCRYPTED_LENGTH];
             reverse_chunks(value, value_len, buffer);
-            xxtea->decrypt(buffer, value_len);
-            reverse_chunks(buffer, value_len, value);
-            return value;
+            xxtea.decrypt(buffer, value_len);
+            reverse_chunks(buffer, value_len, plain);
         }
 
         void copy_address(uint64_t mac, esp_bd_addr_t bd_addr)
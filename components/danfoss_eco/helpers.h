@@ -14,18 +14,23 @@ namespace esphome
 
         void encode_hex(const uint8_t *data, size_t len, char *buff);
         void parse_hex_str(const char *data, size_t str_len, uint8_t *buff);
-        uint32_t parse_int(uint8_t *data, int start_pos);
-        uint16_t parse_short(uint8_t *data, int start_pos);
+        uint32_t parse_int(const uint8_t *data, int start_pos);
+        uint16_t parse_short(const uint8_t *data, int start_pos);
         void write_int(uint8_t *data, int start_pos, int value);
 
         bool parse_bit(uint8_t data, int pos);
         bool parse_bit(uint16_t data, int pos);
         void set_bit(uint8_t data, int pos, bool value);
 
-        void reverse_chunks(uint8_t *data, int len, uint8_t *reversed_buff);
+        void reverse_chunks(const uint8_t *data, int len, uint8_t *reversed_buff);
 
-        uint8_t *encrypt(shared_ptr<Xxtea> &xxtea, uint8_t *value, uint16_t value_len);
-        uint8_t *decrypt(shared_ptr<Xxtea> &xxtea, uint8_t *value, uint16_t value_len);
+        // longest encrypted characteristic value (settings)
+        inline constexpr uint16_t MAX_ENCRYPTED_LENGTH = 16;
+
+        // encrypts value in place, value_len should not exceed MAX_ENCRYPTED_LENGTH
+        void encrypt(Xxtea &xxtea, uint8_t *value, uint16_t value_len);
+        // decrypts value into plain buffer, leaving the value untouched
+        void decrypt(Xxtea &xxtea, const uint8_t *value, uint16_t value_len, uint8_t *plain);
 
         void copy_address(uint64_t, esp_bd_addr_t);
     }
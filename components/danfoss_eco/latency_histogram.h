@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome
+{
+    namespace danfoss_eco
+    {
+        // measured latencies of a device, each one is kept in its own histogram
+        enum class LatencyMetric : uint8_t
+        {
+            CONNECT = 0, // connect() -> ESP_GATTC_OPEN_EVT
+            DISCOVERY,   // ESP_GATTC_OPEN_EVT -> ESP_GATTC_SEARCH_CMPL_EVT (or cached handles applied)
+            PIN,         // -> PIN write acknowledged
+            READ,        // read request -> ESP_GATTC_READ_CHAR_EVT / ESP_GATTC_READ_MULTIPLE_EVT
+            WRITE,       // write request -> ESP_GATTC_WRITE_CHAR_EVT
+            DISCONNECT,  // disconnect() -> ESP_GATTC_DISCONNECT_EVT
+            CONTROL      // control() -> write acknowledged, end-to-end latency of a user initiated change
+        };
+
+        inline constexpr uint8_t LATENCY_METRIC_COUNT = 7;
+
+        // statistics, which can be published as sensors
+        enum class LatencyStat : uint8_t
+        {
+            P50 = 0,
+            P95,
+            MAX,
+            SUCCESSES,
+            FAILURES
+        };
+
+        inline constexpr uint8_t LATENCY_STAT_COUNT = 5;
+
+        // Fixed-bucket histogram of latencies in ms, it never allocates.
+        // Percentiles are approximated by the upper bound of the bucket (capped by the max observed value),
+        // which is good enough to find a slow radiator.
+        class LatencyHistogram
+        {
+        public:
+            static constexpr uint8_t BUCKET_COUNT = 12;
+
+            void record(uint32_t latency)
+            {
+                uint8_t i = 0;
+                while (i < BUCKET_COUNT - 1 && latency > BOUNDS[i])
+                    i++;
+
+                // counts are halved on overflow, so the distribution is kept while old samples fade out
+                if (this->counts_[i] == UINT16_MAX)
+                {
+                    for (auto &count : this->counts_)
+                        count /= 2;
+                }
+
+                this->counts_[i]++;
+                if (latency > this->max_)
+                    this->max_ = latency;
+                this->successes_++;
+            }
+
+            void record_failure() { this->failures_++; }
+
+            // returns the latency, which is not exceeded by the given percent of samples
+            uint32_t percentile(uint8_t percent) const
+            {
+                uint32_t total = 0;
+                for (auto count : this->counts_)
+                    total += count;
+                if (total == 0)
+                    return 0;
+
+                uint32_t rank = (total * percent + 99) / 100;
+                uint32_t seen = 0;
+                for (uint8_t i = 0; i < BUCKET_COUNT - 1; i++)
+                {
+                    seen += this->counts_[i];
+                    if (seen >= rank)
+                        return BOUNDS[i] < this->max_ ? BOUNDS[i] : this->max_;
+                }
+                return this->max_;
+            }
+
+            uint32_t value(LatencyStat stat) const
+            {
+                switch (stat)
+                {
+                case LatencyStat::P50:
+                    return this->percentile(50);
+                case LatencyStat::P95:
+                    return this->percentile(95);
+                case LatencyStat::MAX:
+                    return this->max_;
+                case LatencyStat::SUCCESSES:
+                    return this->successes_;
+                case LatencyStat::FAILURES:
+                default:
+                    return this->failures_;
+                }
+            }
+
+            uint32_t max() const { return this->max_; }
+            uint32_t successes() const { return this->successes_; }
+            uint32_t failures() const { return this->failures_; }
+
+        protected:
+            // upper bounds of the buckets in ms, the last bucket is unbounded
+            static constexpr uint32_t BOUNDS[BUCKET_COUNT - 1] = {10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000};
+
+            uint16_t counts_[BUCKET_COUNT]{0};
+            uint32_t max_{0};
+            uint32_t successes_{0};
+            uint32_t failures_{0};
+        };
+
+    } // namespace danfoss_eco
+} // namespace esphome
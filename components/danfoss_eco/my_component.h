@@ -16,7 +16,9 @@ namespace esphome
         using namespace esphome::sensor;
         using namespace esphome::binary_sensor;
 
-        class MyComponent : public Climate, public PollingComponent, public enable_shared_from_this<MyComponent>
+        class WritableProperty;
+
+        class MyComponent : public Climate, public PollingComponent
         {
         public:
             float get_setup_priority() const override { return setup_priority::DATA; }
@@ -44,7 +46,9 @@ namespace esphome
             Sensor *temperature() { return this->temperature_; }
             BinarySensor *problems() { return this->problems_; }
 
-            virtual void set_secret_key(uint8_t *, bool) = 0;
+            virtual void set_secret_key(const uint8_t *, bool) = 0;
+            // a write of the property is debounced, queued or sent and not acknowledged yet
+            virtual bool write_outstanding(const WritableProperty *) = 0;
 
         protected:
             Sensor *battery_level_{nullptr};
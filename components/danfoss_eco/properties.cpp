@@ -1,6 +1,8 @@
 #include "esphome/components/climate/climate.h"
 #include "esphome/core/log.h"
 
+#include <cinttypes>
+
 #include "properties.h"
 #include "helpers.h"
 
@@ -10,13 +12,28 @@ namespace esphome
 {
     namespace danfoss_eco
     {
+        ESPBTUUID to_uuid(uint32_t uuid)
+        {
+            if (uuid <= 0xFFFF)
+                return ESPBTUUID::from_uint16(uuid);
+
+            // xxxxxxxx-2749-0001-0000-00805f9b042f, little-endian
+            uint8_t raw[16] = {0x2f, 0x04, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x00, 0x01, 0x00, 0x49, 0x27};
+            raw[12] = uuid;
+            raw[13] = uuid >> 8;
+            raw[14] = uuid >> 16;
+            raw[15] = uuid >> 24;
+            return ESPBTUUID::from_raw(raw);
+        }
+
         bool DeviceProperty::init_handle(BLEClient *client)
         {
-            ESP_LOGV(TAG, "[%s] resolving handler for service=%s, characteristic=%s", this->component_->get_name().c_str(), this->service_uuid.to_string().c_str(), this->characteristic_uuid.to_string().c_str());
-            auto chr = client->get_characteristic(this->service_uuid, this->characteristic_uuid);
+            ESP_LOGV(TAG, "[%s] resolving handler for service=%08" PRIx32 ", characteristic=%08" PRIx32, this->component_->get_name().c_str(), this->descriptor().service, this->descriptor().characteristic);
+            auto chr = client->get_characteristic(to_uuid(this->descriptor().service), to_uuid(this->descriptor().characteristic));
             if (chr == nullptr)
             {
-                ESP_LOGW(TAG, "[%s] characteristic uuid=%s not found", this->component_->get_name().c_str(), this->characteristic_uuid.to_string().c_str());
+                ESP_LOGW(TAG, "[%s] characteristic uuid=%08" PRIx32 " not found", this->component_->get_name().c_str(), this->descriptor().characteristic);
+                this->handle = INVALID_HANDLE;
                 return false;
             }
 
@@ -26,6 +43,7 @@ namespace esphome
 
         bool DeviceProperty::read_request(BLEClient *client)
         {
+            this->requested_at = millis();
             auto status = esp_ble_gattc_read_char(client->get_gattc_if(),
                                                   client->get_conn_id(),
                                                   this->handle,
@@ -36,9 +54,30 @@ namespace esphome
             return status == ESP_OK;
         }
 
+        void DeviceProperty::handle_value(const uint8_t *value, uint16_t value_len)
+        {
+            ESP_LOGV(TAG, "[%s] raw value: handle=%#04x, value=%s", this->component_->get_name().c_str(), this->handle, format_hex_pretty(value, value_len).c_str());
+            if (value_len != this->value_length() || value_len > MAX_ENCRYPTED_LENGTH)
+            {
+                ESP_LOGW(TAG, "[%s] unexpected value length: handle=%#04x, length=%d", this->component_->get_name().c_str(), this->handle, value_len);
+                return;
+            }
+
+            if (!this->descriptor().encrypted)
+            {
+                this->update_state(value, value_len);
+                return;
+            }
+
+            uint8_t plain[MAX_ENCRYPTED_LENGTH];
+            decrypt(*this->xxtea_, value, value_len, plain);
+            this->update_state(plain, value_len);
+        }
+
         bool WritableProperty::write_request(BLEClient *client, uint8_t *data, uint16_t data_len)
         {
-            ESP_LOGD(TAG, "[%s] write_request: handle=%#04x, data=%s", this->component_->get_name().c_str(), this->handle, format_hex_pretty(data, data_len).c_str());
+            ESP_LOGV(TAG, "[%s] write_request: handle=%#04x, data=%s", this->component_->get_name().c_str(), this->handle, format_hex_pretty(data, data_len).c_str());
+            this->requested_at = millis();
 
             auto status = esp_ble_gattc_write_char(client->get_gattc_if(),
                                                    client->get_conn_id(),
@@ -55,13 +94,14 @@ namespace esphome
 
         bool WritableProperty::write_request(BLEClient *client)
         {
-            WritableData *writableData = static_cast<WritableData *>(this->data.get());
-            uint8_t buff[this->data->length]{0};
-            writableData->pack(buff);
-            return this->write_request(client, buff, sizeof(buff));
+            uint8_t buff[MAX_ENCRYPTED_LENGTH]{0};
+            this->pack(buff);
+            if (this->descriptor().encrypted)
+                encrypt(*this->xxtea_, buff, this->value_length());
+            return this->write_request(client, buff, this->value_length());
         }
 
-        void BatteryProperty::update_state(uint8_t *value, uint16_t value_len)
+        void BatteryProperty::update_state(const uint8_t *value, uint16_t value_len)
         {
             uint8_t battery_level = value[0];
             ESP_LOGD(TAG, "[%s] battery level: %d %%", this->component_->get_name().c_str(), battery_level);
@@ -69,26 +109,29 @@ namespace esphome
                 this->component_->battery_level()->publish_state(battery_level);
         }
 
-        void TemperatureProperty::update_state(uint8_t *value, uint16_t value_len)
+        void TemperatureProperty::update_state(const uint8_t *value, uint16_t value_len)
         {
-            // Log raw BLE data BEFORE decryption
-            ESP_LOGD(TAG, "[%s] TEMP RAW BLE[%d]: %02x %02x %02x %02x %02x %02x %02x %02x", 
-                     this->component_->get_name().c_str(), value_len,
-                     value_len > 0 ? value[0] : 0, value_len > 1 ? value[1] : 0,
-                     value_len > 2 ? value[2] : 0, value_len > 3 ? value[3] : 0,
-                     value_len > 4 ? value[4] : 0, value_len > 5 ? value[5] : 0,
-                     value_len > 6 ? value[6] : 0, value_len > 7 ? value[7] : 0);
-            
-            auto t_data = new TemperatureData(this->xxtea_, value, value_len);
-            this->data.reset(t_data);
+            TemperatureData *t_data = &this->data;
+            float desired_temperature = t_data->target_temperature;
+            t_data->unpack(value);
+            if (this->component_->write_outstanding(this))
+                t_data->target_temperature = desired_temperature;
+            this->has_data = true;
 
             // Log processed data AFTER decryption
-            ESP_LOGD(TAG, "[%s] TEMP PROCESSED: room=%.1f target=%.1f", 
+            ESP_LOGV(TAG, "[%s] TEMP PROCESSED: room=%.1f target=%.1f", 
                      this->component_->get_name().c_str(), t_data->room_temperature, t_data->target_temperature);
             ESP_LOGD(TAG, "[%s] Current room temperature: %2.1f°C, Set point temperature: %2.1f°C", this->component_->get_name().c_str(), t_data->room_temperature, t_data->target_temperature);
             if (this->component_->temperature() != nullptr)
                 this->component_->temperature()->publish_state(t_data->room_temperature);
 
+            this->publish_state();
+        }
+
+        void TemperatureProperty::publish_state()
+        {
+            TemperatureData *t_data = &this->data;
+
             // apply read configuration to the component
             // TODO component->action should consider "open window detection" feature of Danfoss Eco
             this->component_->action = (t_data->room_temperature > t_data->target_temperature) ? climate::ClimateAction::CLIMATE_ACTION_IDLE : climate::ClimateAction::CLIMATE_ACTION_HEATING;
@@ -97,39 +140,39 @@ namespace esphome
             this->component_->publish_state();
         }
 
-        void SettingsProperty::update_state(uint8_t *value, uint16_t value_len)
+        void SettingsProperty::update_state(const uint8_t *value, uint16_t value_len)
         {
-            // Log raw BLE data BEFORE decryption
-            ESP_LOGD(TAG, "[%s] SETTINGS RAW BLE[%d]: %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x", 
-                     this->component_->get_name().c_str(), value_len,
-                     value_len > 0 ? value[0] : 0, value_len > 1 ? value[1] : 0,
-                     value_len > 2 ? value[2] : 0, value_len > 3 ? value[3] : 0,
-                     value_len > 4 ? value[4] : 0, value_len > 5 ? value[5] : 0,
-                     value_len > 6 ? value[6] : 0, value_len > 7 ? value[7] : 0,
-                     value_len > 8 ? value[8] : 0, value_len > 9 ? value[9] : 0,
-                     value_len > 10 ? value[10] : 0, value_len > 11 ? value[11] : 0,
-                     value_len > 12 ? value[12] : 0, value_len > 13 ? value[13] : 0,
-                     value_len > 14 ? value[14] : 0, value_len > 15 ? value[15] : 0);
-            
-            auto s_data = new SettingsData(this->xxtea_, value, value_len);
-            this->data.reset(s_data);
+            SettingsData *s_data = &this->data;
+            ClimateMode desired_mode = s_data->device_mode;
+            s_data->unpack(value);
+            if (this->component_->write_outstanding(this))
+                s_data->device_mode = desired_mode;
+            this->has_data = true;
+            this->confirmed = true;
 
             const char *name = this->component_->get_name().c_str();
             ESP_LOGD(TAG, "[%s] SETTINGS PROCESSED: min=%.1f max=%.1f mode=%d", 
                      name, s_data->temperature_min, s_data->temperature_max, (int)s_data->device_mode);
-            ESP_LOGD(TAG, "[%s] adaptable_regulation: %d", name, s_data->get_adaptable_regulation());
-            ESP_LOGD(TAG, "[%s] vertical_intallation: %d", name, s_data->get_vertical_intallation());
-            ESP_LOGD(TAG, "[%s] display_flip: %d", name, s_data->get_display_flip());
-            ESP_LOGD(TAG, "[%s] slow_regulation: %d", name, s_data->get_slow_regulation());
-            ESP_LOGD(TAG, "[%s] valve_installed: %d", name, s_data->get_valve_installed());
-            ESP_LOGD(TAG, "[%s] lock_control: %d", name, s_data->get_lock_control());
-            ESP_LOGD(TAG, "[%s] temperature_min: %2.1f°C", name, s_data->temperature_min);
-            ESP_LOGD(TAG, "[%s] temperature_max: %2.1f°C", name, s_data->temperature_max);
-            ESP_LOGD(TAG, "[%s] frost_protection_temperature: %2.1f°C", name, s_data->frost_protection_temperature);
-            ESP_LOGD(TAG, "[%s] schedule_mode: %d", name, s_data->device_mode);
-            ESP_LOGD(TAG, "[%s] vacation_temperature: %2.1f°C", name, s_data->vacation_temperature);
-            ESP_LOGD(TAG, "[%s] vacation_from: %d", name, (int)s_data->vacation_from);
-            ESP_LOGD(TAG, "[%s] vacation_to: %d", name, (int)s_data->vacation_to);
+            ESP_LOGV(TAG, "[%s] adaptable_regulation: %d", name, s_data->get_adaptable_regulation());
+            ESP_LOGV(TAG, "[%s] vertical_intallation: %d", name, s_data->get_vertical_intallation());
+            ESP_LOGV(TAG, "[%s] display_flip: %d", name, s_data->get_display_flip());
+            ESP_LOGV(TAG, "[%s] slow_regulation: %d", name, s_data->get_slow_regulation());
+            ESP_LOGV(TAG, "[%s] valve_installed: %d", name, s_data->get_valve_installed());
+            ESP_LOGV(TAG, "[%s] lock_control: %d", name, s_data->get_lock_control());
+            ESP_LOGV(TAG, "[%s] temperature_min: %2.1f°C", name, s_data->temperature_min);
+            ESP_LOGV(TAG, "[%s] temperature_max: %2.1f°C", name, s_data->temperature_max);
+            ESP_LOGV(TAG, "[%s] frost_protection_temperature: %2.1f°C", name, s_data->frost_protection_temperature);
+            ESP_LOGV(TAG, "[%s] schedule_mode: %d", name, s_data->device_mode);
+            ESP_LOGV(TAG, "[%s] vacation_temperature: %2.1f°C", name, s_data->vacation_temperature);
+            ESP_LOGV(TAG, "[%s] vacation_from: %d", name, (int)s_data->vacation_from);
+            ESP_LOGV(TAG, "[%s] vacation_to: %d", name, (int)s_data->vacation_to);
+
+            this->publish_state();
+        }
+
+        void SettingsProperty::publish_state()
+        {
+            SettingsData *s_data = &this->data;
 
             // apply read configuration to the component
             this->component_->mode = s_data->device_mode;
@@ -138,17 +181,32 @@ namespace esphome
             this->component_->publish_state();
         }
 
-        void ErrorsProperty::update_state(uint8_t *value, uint16_t value_len)
+        void CurrentTimeProperty::update_state(const uint8_t *value, uint16_t value_len)
+        {
+            this->data.unpack(value);
+            this->has_data = true;
+            ESP_LOGD(TAG, "[%s] device time: %d (utc), offset %d s", this->component_->get_name().c_str(), (int)this->data.utc(), (int)this->data.time_offset);
+        }
+
+        void ScheduleDayProperty::update_state(const uint8_t *value, uint16_t value_len)
+        {
+            this->data.unpack(value);
+            this->has_data = true;
+            ESP_LOGV(TAG, "[%s] schedule day: %d periods", this->component_->get_name().c_str(), this->data.count);
+        }
+
+        void ErrorsProperty::update_state(const uint8_t *value, uint16_t value_len)
         {
-            auto e_data = new ErrorsData(this->xxtea_, value, value_len);
-            this->data.reset(e_data);
+            ErrorsData *e_data = &this->data;
+            e_data->unpack(value);
+            this->has_data = true;
 
             const char *name = this->component_->get_name().c_str();
 
-            ESP_LOGD(TAG, "[%s] E9_VALVE_DOES_NOT_CLOSE: %d", name, e_data->E9_VALVE_DOES_NOT_CLOSE);
-            ESP_LOGD(TAG, "[%s] E10_INVALID_TIME: %d", name, e_data->E10_INVALID_TIME);
-            ESP_LOGD(TAG, "[%s] E14_LOW_BATTERY: %d", name, e_data->E14_LOW_BATTERY);
-            ESP_LOGD(TAG, "[%s] E15_VERY_LOW_BATTERY: %d", name, e_data->E15_VERY_LOW_BATTERY);
+            ESP_LOGV(TAG, "[%s] E9_VALVE_DOES_NOT_CLOSE: %d", name, e_data->E9_VALVE_DOES_NOT_CLOSE);
+            ESP_LOGV(TAG, "[%s] E10_INVALID_TIME: %d", name, e_data->E10_INVALID_TIME);
+            ESP_LOGV(TAG, "[%s] E14_LOW_BATTERY: %d", name, e_data->E14_LOW_BATTERY);
+            ESP_LOGV(TAG, "[%s] E15_VERY_LOW_BATTERY: %d", name, e_data->E15_VERY_LOW_BATTERY);
 
             // TODO: it would be great to add actual error code to binary_sensor state attributes, but I'm not sure how to achieve that
             if (this->component_->problems() != nullptr)
@@ -163,7 +221,7 @@ namespace esphome
                 return true;
             }
 
-            auto chr = client->get_characteristic(this->service_uuid, this->characteristic_uuid);
+            auto chr = client->get_characteristic(to_uuid(this->descriptor().service), to_uuid(this->descriptor().characteristic));
             if (chr != nullptr)
             {
                 this->handle = chr->handle;
@@ -175,14 +233,8 @@ namespace esphome
             return false;
         }
 
-        void SecretKeyProperty::update_state(uint8_t *value, uint16_t value_len)
+        void SecretKeyProperty::update_state(const uint8_t *value, uint16_t value_len)
         {
-            if (value_len != SECRET_KEY_LENGTH)
-            {
-                ESP_LOGE(TAG, "[%s] Unexpected secret_key length: %d", this->component_->get_name().c_str(), value_len);
-                return;
-            }
-
             char key_str[SECRET_KEY_LENGTH * 2 + 1];
             encode_hex(value, value_len, key_str);
 
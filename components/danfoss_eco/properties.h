@@ -14,93 +14,248 @@ namespace esphome
         using namespace esphome::esp32_ble_tracker;
         using namespace esphome::ble_client;
 
-        static auto SERVICE_SETTINGS = ESPBTUUID::from_raw("10020000-2749-0001-0000-00805f9b042f");
-        static auto CHARACTERISTIC_PIN = ESPBTUUID::from_raw("10020001-2749-0001-0000-00805f9b042f");         // 0x24
-        static auto CHARACTERISTIC_SETTINGS = ESPBTUUID::from_raw("10020003-2749-0001-0000-00805f9b042f");    // 0x2a
-        static auto CHARACTERISTIC_TEMPERATURE = ESPBTUUID::from_raw("10020005-2749-0001-0000-00805f9b042f"); // 0x2d
-        static auto CHARACTERISTIC_ERRORS = ESPBTUUID::from_raw("10020009-2749-0001-0000-00805f9b042f");      // 0x39
-        static auto CHARACTERISTIC_SECRET_KEY = ESPBTUUID::from_raw("1002000b-2749-0001-0000-00805f9b042f");  // 0x3f
-
-        static auto SERVICE_BATTERY = ESPBTUUID::from_uint32(0x180F);
-        static auto CHARACTERISTIC_BATTERY = ESPBTUUID::from_uint32(0x2A19); // 0x10
-
-        const uint16_t INVALID_HANDLE = -1;
-        
-        const uint8_t SECRET_KEY_LENGTH = 16;
+        // characteristics used by the component, in the order of PROPERTY_DESCRIPTORS
+        enum class PropertyId : uint8_t
+        {
+            PIN = 0,
+            BATTERY,
+            TEMPERATURE,
+            SETTINGS,
+            CURRENT_TIME,
+            ERRORS,
+            SCHEDULE_DAY_SELECT,
+            SCHEDULE_DAY,
+            SECRET_KEY
+        };
+
+        inline constexpr uint8_t PROPERTY_COUNT = (uint8_t)PropertyId::SECRET_KEY + 1;
+
+        // Everything, which identifies a characteristic: adding a new one takes a row here and a PropertyId.
+        // UUIDs up to 0xFFFF are 16 bit Bluetooth SIG ones, the rest are the first 32 bits of the Danfoss
+        // 128 bit UUIDs (xxxxxxxx-2749-0001-0000-00805f9b042f).
+        struct PropertyDescriptor
+        {
+            uint32_t service;
+            uint32_t characteristic;
+            uint16_t length; // expected length of the characteristic value
+            bool encrypted;
+            bool writable;
+        };
+
+        inline constexpr uint32_t SERVICE_SETTINGS = 0x10020000;
+        inline constexpr uint32_t SERVICE_BATTERY = 0x180F;
+
+        inline constexpr PropertyDescriptor PROPERTY_DESCRIPTORS[PROPERTY_COUNT] = {
+            // service, characteristic, length, encrypted, writable
+            {SERVICE_SETTINGS, 0x10020001, 4, false, true},  // PIN, 0x24
+            {SERVICE_BATTERY, 0x2A19, 1, false, false},      // BATTERY, 0x10
+            {SERVICE_SETTINGS, 0x10020005, 8, true, true},   // TEMPERATURE, 0x2d
+            {SERVICE_SETTINGS, 0x10020003, 16, true, true},  // SETTINGS, 0x2a
+            {SERVICE_SETTINGS, 0x10020008, 8, true, true},   // CURRENT_TIME, 0x36
+            {SERVICE_SETTINGS, 0x10020009, 8, true, false},  // ERRORS, 0x39
+            // weekly schedule is transferred day by day: the day is selected first, then its periods are written
+            // NOTE: these characteristics are not documented by Danfoss and were not verified on every firmware
+            {SERVICE_SETTINGS, 0x10020002, 8, true, true},   // SCHEDULE_DAY_SELECT, 0x27
+            {SERVICE_SETTINGS, 0x10020007, 8, true, true},   // SCHEDULE_DAY, 0x33
+            {SERVICE_SETTINGS, 0x1002000b, 16, false, false} // SECRET_KEY, 0x3f
+        };
+
+        static_assert(PROPERTY_DESCRIPTORS[(uint8_t)PropertyId::SETTINGS].length <= MAX_ENCRYPTED_LENGTH, "settings do not fit the plain buffer");
+        static_assert(PROPERTY_DESCRIPTORS[(uint8_t)PropertyId::SECRET_KEY].length <= MAX_ENCRYPTED_LENGTH, "secret key does not fit the plain buffer");
+
+        constexpr bool is_writable(PropertyId id) { return PROPERTY_DESCRIPTORS[(uint8_t)id].writable; }
+
+        // WritableProperty is built only for these, the rest of the characteristics are read only
+        static_assert(is_writable(PropertyId::PIN) && is_writable(PropertyId::TEMPERATURE) && is_writable(PropertyId::SETTINGS) &&
+                          is_writable(PropertyId::CURRENT_TIME) && is_writable(PropertyId::SCHEDULE_DAY_SELECT) && is_writable(PropertyId::SCHEDULE_DAY),
+                      "written characteristic is not writable");
+
+        // ESPBTUUID is built only when the handle is resolved, so the descriptors stay in flash
+        ESPBTUUID to_uuid(uint32_t uuid);
+
+        inline constexpr uint16_t INVALID_HANDLE = 0xFFFF;
+
+        inline constexpr uint8_t SECRET_KEY_LENGTH = 16;
         struct SecretKeyValue
         {
             SecretKeyValue() {}
-            SecretKeyValue(uint8_t *val)
+            SecretKeyValue(const uint8_t *val)
             {
                 memcpy(this->value, (const char *)val, SECRET_KEY_LENGTH);
             }
             uint8_t value[SECRET_KEY_LENGTH];
         };
 
+        // characteristic handles never change for the device, so they are persisted per MAC address
+        // in order to skip waiting for the service discovery on reconnect (secret_key handle is not cached)
+        inline constexpr uint8_t HANDLE_CACHE_SIZE = 5;
+        struct HandleCacheValue
+        {
+            uint16_t handles[HANDLE_CACHE_SIZE];
+        };
+
+        // last known decoded state, persisted per device so it can be controlled right after boot
+        // room temperature is not persisted, it changes with every poll and would wear out the flash
+        struct StateCacheValue
+        {
+            float target_temperature;
+            SettingsData settings;
+            bool has_temperature;
+            bool has_settings;
+        };
+
+        // weekly schedule, as it was last written to the device
+        struct ScheduleCacheValue
+        {
+            ScheduleData schedule;
+            uint8_t days; // bitmask of the days, which are known to be on the device
+        };
+
         class DeviceProperty
         {
         public:
-            unique_ptr<DeviceData> data{nullptr};
+            DeviceProperty(MyComponent *component, Xxtea *xxtea, PropertyId id) : id(id), component_(component), xxtea_(xxtea) {}
 
-            DeviceProperty(shared_ptr<MyComponent> &component, shared_ptr<Xxtea> &xxtea, ESPBTUUID s_uuid, ESPBTUUID c_uuid) : component_(component), xxtea_(xxtea), service_uuid(s_uuid), characteristic_uuid(c_uuid) {}
+            const PropertyDescriptor &descriptor() const { return PROPERTY_DESCRIPTORS[(uint8_t)this->id]; }
+            uint16_t value_length() const { return this->descriptor().length; }
 
-            virtual void update_state(uint8_t *value, uint16_t value_len){};
+            // checks and decrypts (if needed) the value, which was read from the device, then updates the state
+            void handle_value(const uint8_t *value, uint16_t value_len);
 
             virtual bool init_handle(BLEClient *);
             bool read_request(BLEClient *client);
 
-            uint16_t handle;
+            const PropertyId id;
+            uint16_t handle{INVALID_HANDLE};
+            uint32_t requested_at{0}; // millis() of the last read or write request, for latency measurement
+            uint8_t retries{0};       // timed out requests in a row
 
         protected:
-            shared_ptr<MyComponent> component_{nullptr};
-            shared_ptr<Xxtea> xxtea_{nullptr};
+            // decodes the plain value of value_length() bytes
+            virtual void update_state(const uint8_t *value, uint16_t value_len){};
+
+            MyComponent *component_{nullptr}; // the device, which embeds the property
+            Xxtea *xxtea_{nullptr};
+        };
 
-            ESPBTUUID service_uuid;
-            ESPBTUUID characteristic_uuid;
+        // how the device state is confirmed, once the write is acknowledged
+        enum class WriteVerification : uint8_t
+        {
+            NONE,        // trust the acknowledgement, written data is published as is
+            READ_BACK,   // read the written characteristic only
+            FULL_REFRESH // read the complete device state
         };
 
         class WritableProperty : public DeviceProperty
         {
         public:
-            WritableProperty(shared_ptr<MyComponent> &component, shared_ptr<Xxtea> &xxtea, ESPBTUUID s_uuid, ESPBTUUID c_uuid) : DeviceProperty(component, xxtea, s_uuid, c_uuid) {}
+            WritableProperty(MyComponent *component, Xxtea *xxtea, PropertyId id) : DeviceProperty(component, xxtea, id) {}
 
             bool write_request(BLEClient *client);
             bool write_request(BLEClient *client, uint8_t *data, uint16_t data_len);
+
+            // debounced write, which is not queued yet: reads should not override the desired value
+            bool write_pending{false};
+            uint32_t write_due{0};
+
+            WriteVerification verification{WriteVerification::READ_BACK};
+
+            // applies the property data to the component, without waiting for the device to confirm it
+            virtual void publish_state() {}
+
+        protected:
+            // serializes the property data into plain buffer of value_length() bytes
+            virtual void pack(uint8_t *buff) {}
         };
 
         class BatteryProperty : public DeviceProperty
         {
         public:
-            BatteryProperty(shared_ptr<MyComponent> &component, shared_ptr<Xxtea> &xxtea) : DeviceProperty(component, xxtea, SERVICE_BATTERY, CHARACTERISTIC_BATTERY) {}
-            void update_state(uint8_t *value, uint16_t value_len) override;
+            BatteryProperty(MyComponent *component, Xxtea *xxtea) : DeviceProperty(component, xxtea, PropertyId::BATTERY) {}
+            void update_state(const uint8_t *value, uint16_t value_len) override;
         };
 
         class TemperatureProperty : public WritableProperty
         {
         public:
-            TemperatureProperty(shared_ptr<MyComponent> &component, shared_ptr<Xxtea> &xxtea) : WritableProperty(component, xxtea, SERVICE_SETTINGS, CHARACTERISTIC_TEMPERATURE) {}
-            void update_state(uint8_t *value, uint16_t value_len) override;
+            TemperatureProperty(MyComponent *component, Xxtea *xxtea) : WritableProperty(component, xxtea, PropertyId::TEMPERATURE) {}
+            void update_state(const uint8_t *value, uint16_t value_len) override;
+            void publish_state() override;
+
+            TemperatureData data{};
+            bool has_data{false};
+
+        protected:
+            void pack(uint8_t *buff) override { this->data.pack(buff); }
         };
 
         class SettingsProperty : public WritableProperty
         {
         public:
-            SettingsProperty(shared_ptr<MyComponent> &component, shared_ptr<Xxtea> &xxtea) : WritableProperty(component, xxtea, SERVICE_SETTINGS, CHARACTERISTIC_SETTINGS) {}
-            void update_state(uint8_t *value, uint16_t value_len) override;
+            SettingsProperty(MyComponent *component, Xxtea *xxtea) : WritableProperty(component, xxtea, PropertyId::SETTINGS) {}
+            void update_state(const uint8_t *value, uint16_t value_len) override;
+            void publish_state() override;
+
+            SettingsData data{};
+            bool has_data{false};
+            bool confirmed{false}; // data was read from the device, not just restored from flash
+
+        protected:
+            void pack(uint8_t *buff) override { this->data.pack(buff); }
+        };
+
+        class CurrentTimeProperty : public WritableProperty
+        {
+        public:
+            CurrentTimeProperty(MyComponent *component, Xxtea *xxtea) : WritableProperty(component, xxtea, PropertyId::CURRENT_TIME) {}
+            void update_state(const uint8_t *value, uint16_t value_len) override;
+
+            CurrentTimeData data{};
+            bool has_data{false};
+
+        protected:
+            void pack(uint8_t *buff) override { this->data.pack(buff); }
+        };
+
+        class ScheduleDaySelectProperty : public WritableProperty
+        {
+        public:
+            ScheduleDaySelectProperty(MyComponent *component, Xxtea *xxtea) : WritableProperty(component, xxtea, PropertyId::SCHEDULE_DAY_SELECT) {}
+
+            uint8_t day{0}; // 0 is monday
+
+        protected:
+            void pack(uint8_t *buff) override { buff[0] = this->day; }
+        };
+
+        class ScheduleDayProperty : public WritableProperty
+        {
+        public:
+            ScheduleDayProperty(MyComponent *component, Xxtea *xxtea) : WritableProperty(component, xxtea, PropertyId::SCHEDULE_DAY) {}
+            void update_state(const uint8_t *value, uint16_t value_len) override;
+
+            ScheduleDayData data{};
+            bool has_data{false};
+
+        protected:
+            void pack(uint8_t *buff) override { this->data.pack(buff); }
         };
 
         class ErrorsProperty : public DeviceProperty
         {
         public:
-            ErrorsProperty(shared_ptr<MyComponent> &component, shared_ptr<Xxtea> &xxtea) : DeviceProperty(component, xxtea, SERVICE_SETTINGS, CHARACTERISTIC_ERRORS) {}
-            void update_state(uint8_t *value, uint16_t value_len) override;
+            ErrorsProperty(MyComponent *component, Xxtea *xxtea) : DeviceProperty(component, xxtea, PropertyId::ERRORS) {}
+            void update_state(const uint8_t *value, uint16_t value_len) override;
+
+            ErrorsData data{};
+            bool has_data{false};
         };
 
         class SecretKeyProperty : public DeviceProperty
         {
         public:
-            SecretKeyProperty(shared_ptr<MyComponent> &component, shared_ptr<Xxtea> &xxtea) : DeviceProperty(component, xxtea, SERVICE_SETTINGS, CHARACTERISTIC_SECRET_KEY) {}
-            void update_state(uint8_t *value, uint16_t value_len) override;
+            SecretKeyProperty(MyComponent *component, Xxtea *xxtea) : DeviceProperty(component, xxtea, PropertyId::SECRET_KEY) {}
+            void update_state(const uint8_t *value, uint16_t value_len) override;
 
             bool init_handle(BLEClient *) override;
         };
@@ -0,0 +1,313 @@
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+#include <algorithm>
+#include <cinttypes>
+
+#include "scheduler.h"
+#include "device.h"
+
+#ifdef USE_ESP32
+
+namespace esphome
+{
+    namespace danfoss_eco
+    {
+        static const char *const SCHEDULER_TAG = "danfoss_eco.scheduler";
+
+        // millis() overflow-safe comparison of two points in time
+        static inline bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+        static inline bool reached(uint32_t now, uint32_t deadline) { return !before(now, deadline); }
+
+        void ConnectionScheduler::dump_config()
+        {
+            ESP_LOGCONFIG(SCHEDULER_TAG, "Danfoss Eco Connection Scheduler:");
+            ESP_LOGCONFIG(SCHEDULER_TAG, "  Max Connections: %d", this->max_connections_);
+            ESP_LOGCONFIG(SCHEDULER_TAG, "  Connection Timeout: %" PRIu32 " ms", this->connection_timeout_);
+            ESP_LOGCONFIG(SCHEDULER_TAG, "  Advertisement Timeout: %" PRIu32 " ms", this->advertisement_timeout_);
+            ESP_LOGCONFIG(SCHEDULER_TAG, "  Devices: %u", (unsigned)this->entries_.size());
+            ESP_LOGCONFIG(SCHEDULER_TAG, "  Group Operations: %d concurrent, timeout %" PRIu32 " ms", this->group_concurrency_, this->group_timeout_);
+        }
+
+        void ConnectionScheduler::register_device(Device *device)
+        {
+            device->set_scheduler(this, this->entries_.size());
+            this->entries_.push_back(Entry{device, 0, 0, 0, false, false, false, false, GroupState::NONE, 0});
+        }
+
+        void ConnectionScheduler::loop()
+        {
+            uint32_t now = millis();
+
+            // reclaim slots from the connections, which were never established (i.e. device is out of range)
+            for (auto &entry : this->entries_)
+            {
+                if (entry.active && !entry.device->is_established() && reached(now, entry.active_since + this->connection_timeout_))
+                {
+                    ESP_LOGW(SCHEDULER_TAG, "[%s] connection was not established in %" PRIu32 " ms, giving up", entry.device->get_name().c_str(), this->connection_timeout_);
+                    entry.device->record_connection_result(false);
+                    entry.device->disconnect();
+                }
+            }
+
+            this->run_group(now);
+
+            while (this->active_connections_ < this->max_connections_)
+            {
+                Entry *entry = this->next_due(now);
+                if (entry == nullptr)
+                    break;
+
+                entry->queued = false;
+                entry->active = true;
+                entry->active_since = now;
+                this->active_connections_++;
+
+                ESP_LOGV(SCHEDULER_TAG, "[%s] granted connection slot, active=%d", entry->device->get_name().c_str(), this->active_connections_);
+                entry->device->connect();
+            }
+        }
+
+        void ConnectionScheduler::request_poll(Device *device)
+        {
+            Entry *entry = this->find(device);
+            if (entry == nullptr)
+                return;
+
+            uint32_t now = millis();
+            uint32_t interval = device->get_update_interval();
+            if (!entry->polled || interval == 0)
+            {
+                entry->polled = true;
+                this->enqueue(entry, now, false);
+                return;
+            }
+
+            if (entry->phase == 0)
+                entry->phase = fnv1_hash(device->parent()->address_str());
+
+            // delay the poll till the next point in time, which matches the device phase,
+            // this way devices with the same update_interval never poll at the same time
+            uint32_t delay = (entry->phase % interval + interval - now % interval) % interval;
+            this->enqueue(entry, now + delay, false);
+        }
+
+        void ConnectionScheduler::request_connection(Device *device)
+        {
+            Entry *entry = this->find(device);
+            if (entry != nullptr)
+                this->enqueue(entry, millis(), true);
+        }
+
+        void ConnectionScheduler::release(Device *device)
+        {
+            Entry *entry = this->find(device);
+            if (entry == nullptr)
+                return;
+
+            if (entry->active)
+            {
+                entry->active = false;
+                this->active_connections_--;
+            }
+        }
+
+        bool ConnectionScheduler::is_queued(Device *device)
+        {
+            Entry *entry = this->find(device);
+            return entry != nullptr && entry->queued;
+        }
+
+        void ConnectionScheduler::on_secret_key_ready(uint64_t address)
+        {
+            for (auto &entry : this->entries_)
+            {
+                if (entry.device->parent()->get_address() == address)
+                {
+                    entry.device->request_secret_key();
+                    return;
+                }
+            }
+            ESP_LOGD(SCHEDULER_TAG, "no eTRV is configured for MAC %012llx", (unsigned long long)address);
+        }
+
+        void ConnectionScheduler::start_group(const vector<Device *> &devices, const GroupCommand &command)
+        {
+            uint32_t now = millis();
+            if (this->group_active_)
+            {
+                ESP_LOGW(SCHEDULER_TAG, "group operation is superseded by the new one");
+                this->complete_group(now);
+            }
+
+            uint8_t count = 0;
+            for (auto &entry : this->entries_)
+            {
+                bool member = devices.empty() || std::find(devices.begin(), devices.end(), entry.device) != devices.end();
+                entry.group = member ? GroupState::WAITING : GroupState::NONE;
+                if (member)
+                    count++;
+            }
+
+            this->group_command_ = command;
+            this->group_active_ = true;
+            this->group_started_at_ = now;
+            this->group_succeeded_ = 0;
+            this->group_failed_ = 0;
+            ESP_LOGI(SCHEDULER_TAG, "group operation started for %d devices", count);
+            this->run_group(now);
+        }
+
+        void ConnectionScheduler::on_group_result(Device *device, bool success)
+        {
+            Entry *entry = this->find(device);
+            // results of the devices, which have timed out (or belong to a superseded operation), are ignored
+            if (entry != nullptr && this->group_active_ && entry->group == GroupState::RUNNING)
+                this->finish_group_entry(entry, success);
+        }
+
+        void ConnectionScheduler::run_group(uint32_t now)
+        {
+            if (!this->group_active_)
+                return;
+
+            uint8_t running = 0;
+            for (auto &entry : this->entries_)
+            {
+                if (entry.group == GroupState::RUNNING && reached(now, entry.group_started + this->group_timeout_))
+                {
+                    ESP_LOGW(SCHEDULER_TAG, "[%s] group command was not confirmed in %" PRIu32 " ms", entry.device->get_name().c_str(), this->group_timeout_);
+                    this->finish_group_entry(&entry, false);
+                }
+                if (entry.group == GroupState::RUNNING)
+                    running++;
+            }
+
+            while (running < this->group_concurrency_)
+            {
+                Entry *entry = this->next_group_entry();
+                if (entry == nullptr)
+                    break;
+
+                entry->group = GroupState::RUNNING;
+                entry->group_started = now;
+                switch (entry->device->apply_group_command(this->group_command_))
+                {
+                case GroupApply::STARTED:
+                    running++;
+                    break;
+                case GroupApply::DONE:
+                    this->finish_group_entry(entry, true);
+                    break;
+                case GroupApply::FAILED:
+                    this->finish_group_entry(entry, false);
+                    break;
+                }
+            }
+
+            if (running == 0 && this->next_group_entry() == nullptr)
+                this->complete_group(now);
+        }
+
+        ConnectionScheduler::Entry *ConnectionScheduler::next_group_entry()
+        {
+            // devices with open connections go first, the command is sent over the same connection
+            Entry *best = nullptr;
+            for (auto &entry : this->entries_)
+            {
+                if (entry.group != GroupState::WAITING)
+                    continue;
+                if (best == nullptr || (entry.active && !best->active) || (entry.active == best->active && entry.device->rssi() > best->device->rssi()))
+                    best = &entry;
+            }
+            return best;
+        }
+
+        void ConnectionScheduler::finish_group_entry(Entry *entry, bool success)
+        {
+            entry->group = GroupState::DONE;
+            if (success)
+                this->group_succeeded_++;
+            else
+                this->group_failed_++;
+
+            ESP_LOGD(SCHEDULER_TAG, "[%s] group command %s", entry->device->get_name().c_str(), success ? "succeeded" : "failed");
+            this->group_result_callback_.call(entry->device->get_name(), success);
+        }
+
+        void ConnectionScheduler::complete_group(uint32_t now)
+        {
+            this->group_active_ = false;
+            for (auto &entry : this->entries_)
+                entry.group = GroupState::NONE;
+
+            uint32_t duration = now - this->group_started_at_;
+            ESP_LOGI(SCHEDULER_TAG, "group operation completed in %" PRIu32 " ms: %d succeeded, %d failed", duration, this->group_succeeded_, this->group_failed_);
+            this->group_complete_callback_.call(duration, this->group_succeeded_, this->group_failed_);
+        }
+
+        ConnectionScheduler::Entry *ConnectionScheduler::find(Device *device)
+        {
+            for (auto &entry : this->entries_)
+                if (entry.device == device)
+                    return &entry;
+            return nullptr;
+        }
+
+        ConnectionScheduler::Entry *ConnectionScheduler::next_due(uint32_t now)
+        {
+            Entry *best = nullptr;
+            for (auto &entry : this->entries_)
+            {
+                if (!entry.queued || !reached(now, entry.due))
+                    continue;
+
+                // there is no point to spend a connection slot on the device, which does not advertise
+                if (!entry.urgent && this->advertisement_timeout_ > 0 && !entry.device->is_reachable(now, this->advertisement_timeout_))
+                {
+                    ESP_LOGD(SCHEDULER_TAG, "[%s] no advertisements for %" PRIu32 "s, skipping the poll",
+                             entry.device->get_name().c_str(), (now - entry.device->last_seen()) / 1000);
+                    entry.queued = false;
+                    continue;
+                }
+
+                // previous link of the device is still being closed, request is kept till it is down
+                if (entry.device->parent()->state() == ble_client::ClientState::DISCONNECTING)
+                    continue;
+
+                // failed device is backing off, request is kept till the next attempt is allowed
+                if (!entry.device->may_connect(now))
+                    continue;
+
+                if (best == nullptr || this->goes_before(&entry, best))
+                    best = &entry;
+            }
+            return best;
+        }
+
+        bool ConnectionScheduler::goes_before(Entry *a, Entry *b)
+        {
+            if (a->urgent != b->urgent)
+                return a->urgent;
+            if (a->device->rssi() != b->device->rssi())
+                return a->device->rssi() > b->device->rssi();
+            return before(a->due, b->due);
+        }
+
+        void ConnectionScheduler::enqueue(Entry *entry, uint32_t due, bool urgent)
+        {
+            // device is connected (or connecting) already, queued commands will be sent over the same connection
+            if (entry->active)
+                return;
+
+            // keep the earliest deadline, if there is a request queued already
+            if (!entry->queued || before(due, entry->due))
+                entry->due = due;
+            entry->urgent = urgent || (entry->queued && entry->urgent);
+            entry->queued = true;
+        }
+
+    } // namespace danfoss_eco
+} // namespace esphome
+
+#endif // USE_ESP32
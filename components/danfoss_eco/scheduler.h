@@ -0,0 +1,139 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+#include "esphome/components/climate/climate.h"
+
+#include "event_trace.h"
+
+#include <vector>
+
+#ifdef USE_ESP32
+
+namespace esphome
+{
+    namespace danfoss_eco
+    {
+        using namespace std;
+
+        class Device;
+
+        // setpoint and/or mode, applied to every device of a group operation
+        struct GroupCommand
+        {
+            optional<float> target_temperature;
+            optional<climate::ClimateMode> mode;
+        };
+
+        // outcome of applying the group command to a single device
+        enum class GroupApply : uint8_t
+        {
+            STARTED, // writes are scheduled, the device reports the result once they are acknowledged
+            DONE,    // device is at the requested state already
+            FAILED   // device state is unknown (never read), nothing to write to
+        };
+
+        // Shared by all eTRVs on the gateway: limits the number of concurrent BLE connections
+        // and hands out connection slots to the devices in the order of their deadlines.
+        // When several requests are due, user initiated ones go first, then devices with the stronger signal.
+        // Devices with failed connections are skipped, till their circuit breaker allows the next attempt.
+        // Group operations apply the same setpoint to several devices, with at most group_concurrency of them in progress.
+        class ConnectionScheduler : public Component
+        {
+        public:
+            void loop() override;
+            void dump_config() override;
+            float get_setup_priority() const override { return setup_priority::DATA; }
+
+            void set_max_connections(uint8_t max_connections) { this->max_connections_ = max_connections; }
+            void set_connection_timeout(uint32_t timeout) { this->connection_timeout_ = timeout; }
+            void set_advertisement_timeout(uint32_t timeout) { this->advertisement_timeout_ = timeout; }
+            void set_group_concurrency(uint8_t group_concurrency) { this->group_concurrency_ = group_concurrency; }
+            void set_group_timeout(uint32_t timeout) { this->group_timeout_ = timeout; }
+
+            void register_device(Device *device);
+
+            // queue a regular state poll, aligned to the device's own phase within its update interval
+            void request_poll(Device *device);
+            // queue a connection, which is due right away (i.e. user initiated control)
+            void request_connection(Device *device);
+            // returns the connection slot, held by the device (if any)
+            void release(Device *device);
+
+            bool is_queued(Device *device);
+
+            // eTRV with the given MAC is ready to share its secret key (hardware button was pressed)
+            void on_secret_key_ready(uint64_t address);
+
+            // applies the command to the given devices (all registered ones, if empty),
+            // a new group operation cancels the one in progress
+            void start_group(const vector<Device *> &devices, const GroupCommand &command);
+            // device has finished (or failed) the writes of the group command
+            void on_group_result(Device *device, bool success);
+
+            void add_on_group_result_callback(std::function<void(std::string, bool)> &&callback) { this->group_result_callback_.add(std::move(callback)); }
+            void add_on_group_complete_callback(std::function<void(uint32_t, int, int)> &&callback) { this->group_complete_callback_.add(std::move(callback)); }
+
+            EventTrace &trace() { return this->trace_; }
+            void dump_trace() { this->trace_.dump(); }
+
+            // heap memory, taken by each registered device
+            static size_t entry_size() { return sizeof(Entry); }
+
+        protected:
+            enum class GroupState : uint8_t
+            {
+                NONE,
+                WAITING,
+                RUNNING,
+                DONE
+            };
+
+            struct Entry
+            {
+                Device *device;
+                uint32_t phase;        // per-device offset within the update interval, derived from MAC
+                uint32_t due;          // deadline of the queued request
+                uint32_t active_since; // when the connection slot was handed out
+                bool queued;
+                bool urgent; // queued by request_connection(), not subject to the advertisement check
+                bool active;
+                bool polled; // first poll after boot is not delayed
+                GroupState group;
+                uint32_t group_started; // when the group command was applied to the device
+            };
+
+            Entry *find(Device *device);
+            Entry *next_due(uint32_t now);
+            void enqueue(Entry *entry, uint32_t due, bool urgent);
+            bool goes_before(Entry *a, Entry *b);
+
+            void run_group(uint32_t now);
+            Entry *next_group_entry();
+            void finish_group_entry(Entry *entry, bool success);
+            void complete_group(uint32_t now);
+
+            vector<Entry> entries_;
+            uint8_t max_connections_{2};
+            uint32_t connection_timeout_{30000};
+            uint32_t advertisement_timeout_{300000};
+            uint8_t active_connections_{0};
+
+            GroupCommand group_command_{};
+            bool group_active_{false};
+            uint32_t group_started_at_{0};
+            uint8_t group_concurrency_{2};
+            uint32_t group_timeout_{60000};
+            uint8_t group_succeeded_{0};
+            uint8_t group_failed_{0};
+            CallbackManager<void(std::string, bool)> group_result_callback_;
+            CallbackManager<void(uint32_t, int, int)> group_complete_callback_;
+
+            // GATT events of all the devices
+            EventTrace trace_;
+        };
+
+    } // namespace danfoss_eco
+} // namespace esphome
+
+#endif // USE_ESP32
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+// all headers of the component are compiled, button component is available only if it is configured
+#if defined(USE_ESP32) && defined(USE_BUTTON)
+
+#include "esphome/core/helpers.h"
+#include "esphome/components/button/button.h"
+
+#include "scheduler.h"
+
+namespace esphome
+{
+    namespace danfoss_eco
+    {
+        // logs the GATT event trace of all the devices on press
+        class DumpTraceButton : public button::Button, public Parented<ConnectionScheduler>
+        {
+        protected:
+            void press_action() override { this->parent_->dump_trace(); }
+        };
+
+    } // namespace danfoss_eco
+} // namespace esphome
+
+#endif // USE_ESP32 && USE_BUTTON
@@ -4,7 +4,7 @@
 #define DELTA 0x9e3779b9
 #define MX (((z>>5^y<<2) + (y>>3^z<<4)) ^ ((sum^y) + (key[(p&3)^e] ^ z)))
 
-int Xxtea::set_key(uint8_t *key, size_t len)
+int Xxtea::set_key(const uint8_t *key, size_t len)
 {
     if (key == nullptr || len != 16) {
         return XXTEA_STATUS_NOT_INITIALIZED;
@@ -89,3 +89,84 @@ void Xxtea::decrypt(uint8_t *data, size_t len)
     int n = (len + 3) / 4;
     xxtea_decrypt((uint32_t*)data, n, key_);
 }
+
+
+static inline uint32_t load_be(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void store_be(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+template <int N>
+void Xxtea::encrypt_be(const uint8_t *in, uint8_t *out)
+{
+    if (status_ != XXTEA_STATUS_SUCCESS) {
+        memmove(out, in, N * 4);
+        return;
+    }
+
+    uint32_t v[N];
+    for (int i = 0; i < N; i++)
+        v[i] = load_be(in + i * 4);
+
+    uint32_t const *key = key_;
+    uint32_t y, z = v[N-1], sum = 0;
+    unsigned p, e;
+
+    for (unsigned rounds = 6 + 52/N; rounds > 0; rounds--) {
+        sum += DELTA;
+        e = (sum >> 2) & 3;
+        for (p=0; p<N-1; p++) {
+            y = v[p+1];
+            z = v[p] += MX;
+        }
+        y = v[0];
+        z = v[N-1] += MX;
+    }
+
+    for (int i = 0; i < N; i++)
+        store_be(out + i * 4, v[i]);
+}
+
+template <int N>
+void Xxtea::decrypt_be(const uint8_t *in, uint8_t *out)
+{
+    if (status_ != XXTEA_STATUS_SUCCESS) {
+        memmove(out, in, N * 4);
+        return;
+    }
+
+    uint32_t v[N];
+    for (int i = 0; i < N; i++)
+        v[i] = load_be(in + i * 4);
+
+    uint32_t const *key = key_;
+    uint32_t y = v[0], z, sum = (6 + 52/N) * DELTA;
+    unsigned p, e;
+
+    for (unsigned rounds = 6 + 52/N; rounds > 0; rounds--) {
+        e = (sum >> 2) & 3;
+        for (p=N-1; p>0; p--) {
+            z = v[p-1];
+            y = v[p] -= MX;
+        }
+        z = v[N-1];
+        y = v[0] -= MX;
+        sum -= DELTA;
+    }
+
+    for (int i = 0; i < N; i++)
+        store_be(out + i * 4, v[i]);
+}
+
+template void Xxtea::encrypt_be<2>(const uint8_t *in, uint8_t *out);
+template void Xxtea::encrypt_be<4>(const uint8_t *in, uint8_t *out);
+template void Xxtea::decrypt_be<2>(const uint8_t *in, uint8_t *out);
+template void Xxtea::decrypt_be<4>(const uint8_t *in, uint8_t *out);
@@ -24,9 +24,17 @@ private:
 public:
     Xxtea() : status_(XXTEA_STATUS_NOT_INITIALIZED) {}
 
-    int set_key(uint8_t *key, size_t len);
+    int set_key(const uint8_t *key, size_t len);
     int status() const { return status_; }
     
     void encrypt(uint8_t *data, size_t len);
     void decrypt(uint8_t *data, size_t len);
+
+    // Single pass kernels for the value sizes used by Danfoss eTRV: N=2 (temperature, errors) and N=4 (settings).
+    // Words are loaded and stored big-endian, which matches reverse_chunks() + encrypt()/decrypt() + reverse_chunks().
+    // in and out may point to the same buffer. Only N=2 and N=4 are instantiated.
+    template <int N>
+    void encrypt_be(const uint8_t *in, uint8_t *out);
+    template <int N>
+    void decrypt_be(const uint8_t *in, uint8_t *out);
 };
@@ -1,4 +1,7 @@
 #include "esphome/core/log.h"
+#include "esphome/core/hal.h"
+
+#include <cinttypes>
 
 #include "device_scanner.h"
 
@@ -8,31 +11,105 @@ namespace esphome
 {
     namespace danfoss_eco_scanner
     {
-        static const string eTRV_SUFFIX = string(";eTRV");
+        static const char eTRV_SUFFIX[] = ";eTRV";
+        static const size_t eTRV_SUFFIX_LEN = sizeof(eTRV_SUFFIX) - 1;
 
         void DanfossEcoScanner::dump_config()
         {
             ESP_LOGCONFIG(TAG, "Danfoss Eco Scanner:");
             ESP_LOGCONFIG(TAG, "  Read Secret: %d", this->read_secret_);
+            ESP_LOGCONFIG(TAG, "  Advertisements: %" PRIu32 ", passed prefilter %" PRIu32 ", eTRV %" PRIu32, this->adverts_, this->passed_, this->matched_);
+            LOG_SENSOR("  ", "Registry Size", this->registry_size_);
+            LOG_SENSOR("  ", "Hit Rate", this->hit_rate_);
+
+            uint32_t now = millis();
+            for (uint8_t i = 0; i < this->registry_count_; i++)
+            {
+                const DiscoveredDevice &d = this->registry_[i];
+                ESP_LOGCONFIG(TAG, "  eTRV %02X:%02X:%02X:%02X:%02X:%02X: RSSI %d dBm, flags %#04x, %" PRIu32 " adverts, last seen %" PRIu32 "s ago",
+                              (uint8_t)(d.address >> 40), (uint8_t)(d.address >> 32), (uint8_t)(d.address >> 24),
+                              (uint8_t)(d.address >> 16), (uint8_t)(d.address >> 8), (uint8_t)d.address,
+                              d.rssi, d.flags, d.adverts, (now - d.last_seen) / 1000);
+            }
+        }
+
+        void DanfossEcoScanner::update()
+        {
+            if (this->registry_size_ != nullptr)
+                this->registry_size_->publish_state(this->registry_count_);
+            if (this->hit_rate_ != nullptr && this->adverts_ > 0)
+                this->hit_rate_->publish_state(100.0f * this->matched_ / this->adverts_);
+        }
+
+        bool DanfossEcoScanner::prefilter(const ESPBTDevice &device)
+        {
+            if ((device.address_uint64() >> 24) == DANFOSS_OUI)
+                return true;
+
+            for (auto &uuid : device.get_service_uuids())
+                if (uuid == DANFOSS_UUID)
+                    return true;
+
+            return false;
         }
 
         bool DanfossEcoScanner::parse_device(const ESPBTDevice &device)
         {
-            string name = device.get_name();
-            int s_len = eTRV_SUFFIX.length();
+            this->adverts_++;
+            if (!this->prefilter(device))
+                return false;
+            this->passed_++;
 
-            if (name.length() <= s_len || name.compare(name.length() - s_len, s_len, eTRV_SUFFIX) != 0)
+            const string &name = device.get_name();
+            if (name.length() <= eTRV_SUFFIX_LEN || name.compare(name.length() - eTRV_SUFFIX_LEN, eTRV_SUFFIX_LEN, eTRV_SUFFIX) != 0)
                 return false;
+            this->matched_++;
 
-            ESP_LOGI(TAG, "Found Danfoss eTRV, MAC: %s, Name: %s", device.address_str().c_str(), name.c_str());
+            bool added;
+            DiscoveredDevice *d = this->find_or_add(device.address_uint64(), added);
+            uint8_t flags = (uint8_t)name[0];
+            bool flags_changed = added || d->flags != flags;
 
-            uint8_t flags = (uint8_t)name.c_str()[0];
-            if ((flags & 0x4) >> 2)
+            d->last_seen = millis();
+            d->adverts++;
+            d->rssi = device.get_rssi();
+            d->flags = flags;
+
+            // only changes are logged, devices advertise several times per second
+            if (added)
+                ESP_LOGI(TAG, "Found Danfoss eTRV, MAC: %s, Name: %s", device.address_str().c_str(), name.c_str());
+            if (flags_changed && (flags & 0x4) >> 2)
+            {
                 ESP_LOGI(TAG, "Ready to read the secret key");
+#ifdef USE_DANFOSS_ECO
+                // the window is short, so the device connects right away instead of waiting for the next poll
+                if (this->hub_ != nullptr)
+                    this->hub_->on_secret_key_ready(d->address);
+#endif
+            }
 
             return true;
         }
 
+        DiscoveredDevice *DanfossEcoScanner::find_or_add(uint64_t address, bool &added)
+        {
+            added = false;
+            DiscoveredDevice *oldest = nullptr;
+            for (uint8_t i = 0; i < this->registry_count_; i++)
+            {
+                DiscoveredDevice *d = &this->registry_[i];
+                if (d->address == address)
+                    return d;
+                if (oldest == nullptr || (int32_t)(d->last_seen - oldest->last_seen) < 0)
+                    oldest = d;
+            }
+
+            added = true;
+            DiscoveredDevice *d = this->registry_count_ < REGISTRY_SIZE ? &this->registry_[this->registry_count_++] : oldest;
+            *d = DiscoveredDevice{address, 0, 0, 0, 0};
+            return d;
+        }
+
     } // namespace danfoss_eco_scanner
 } // namespace esphome
 
@@ -1,8 +1,13 @@
 #pragma once
 
 #include "esphome/core/component.h"
+#include "esphome/components/sensor/sensor.h"
 #include "esphome/components/esp32_ble_tracker/esp32_ble_tracker.h"
 
+#ifdef USE_DANFOSS_ECO
+#include "esphome/components/danfoss_eco/scheduler.h"
+#endif
+
 #ifdef USE_ESP32
 
 namespace esphome
@@ -12,21 +17,58 @@ namespace esphome
         using namespace std;
         using namespace esphome::esp32_ble_tracker;
 
-        static auto DANFOSS_UUID = ESPBTUUID::from_uint16(0x042f);
+        inline const ESPBTUUID DANFOSS_UUID = ESPBTUUID::from_uint16(0x042f);
+        inline constexpr uint64_t DANFOSS_OUI = 0x00042F; // first 3 bytes of the MAC address
         const char *const TAG = "danfoss_eco_scanner";
 
-        class DanfossEcoScanner : public ESPBTDeviceListener, public Component
+        // eTRV, which was seen by the scanner
+        struct DiscoveredDevice
+        {
+            uint64_t address;
+            uint32_t last_seen; // millis()
+            uint32_t adverts;
+            int8_t rssi;
+            uint8_t flags; // first char of the advertised name
+        };
+
+        class DanfossEcoScanner : public ESPBTDeviceListener, public PollingComponent
         {
         public:
             void dump_config() override;
+            void update() override;
             float get_setup_priority() const override { return setup_priority::DATA; }
 
             bool parse_device(const ESPBTDevice &device) override;
 
             void set_read_secret(bool read_secret) { this->read_secret_ = read_secret; }
+            void set_registry_size(sensor::Sensor *registry_size) { this->registry_size_ = registry_size; }
+            void set_hit_rate(sensor::Sensor *hit_rate) { this->hit_rate_ = hit_rate; }
+#ifdef USE_DANFOSS_ECO
+            // configured eTRVs are notified, when they are ready to share the secret key
+            void set_hub(danfoss_eco::ConnectionScheduler *hub) { this->hub_ = hub; }
+#endif
+
+        protected:
+            // cheap checks of the address and service UUIDs, before the name is looked at
+            bool prefilter(const ESPBTDevice &device);
+            DiscoveredDevice *find_or_add(uint64_t address, bool &added);
+
+            // fixed-size registry, the least recently seen device is replaced once it is full
+            static constexpr uint8_t REGISTRY_SIZE = 16;
+            DiscoveredDevice registry_[REGISTRY_SIZE];
+            uint8_t registry_count_{0};
+
+            uint32_t adverts_{0};  // all advertisements
+            uint32_t passed_{0};   // passed the prefilter
+            uint32_t matched_{0};  // eTRV advertisements
 
         private:
             bool read_secret_{false};
+            sensor::Sensor *registry_size_{nullptr};
+            sensor::Sensor *hit_rate_{nullptr};
+#ifdef USE_DANFOSS_ECO
+            danfoss_eco::ConnectionScheduler *hub_{nullptr};
+#endif
         };
 
     } // namespace danfoss_eco_scanner
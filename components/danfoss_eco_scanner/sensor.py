@@ -1,15 +1,25 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.components import sensor, esp32_ble_tracker
-from esphome.const import CONF_ID
+from esphome.const import (
+    CONF_ID,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    UNIT_PERCENT,
+)
 
 AUTO_LOAD = ["esp32_ble_tracker"]
 
+CONF_DANFOSS_ECO_ID = 'danfoss_eco_id'
+
 CONF_READ_SECRET = 'read_secret'
+CONF_REGISTRY_SIZE = 'registry_size'
+CONF_HIT_RATE = 'hit_rate'
 
 scanner_ns = cg.esphome_ns.namespace("danfoss_eco_scanner")
+ConnectionScheduler = cg.esphome_ns.namespace("danfoss_eco").class_("ConnectionScheduler", cg.Component)
 DanfossEcoScanner = scanner_ns.class_(
-    "DanfossEcoScanner", cg.Component, esp32_ble_tracker.ESPBTDeviceListener
+    "DanfossEcoScanner", cg.PollingComponent, esp32_ble_tracker.ESPBTDeviceListener
 )
 
 CONFIG_SCHEMA = cv.All(
@@ -17,10 +27,22 @@ CONFIG_SCHEMA = cv.All(
         {
             cv.GenerateID(): cv.declare_id(DanfossEcoScanner),
             cv.Optional(CONF_READ_SECRET, default=False): cv.boolean,
+            cv.Optional(CONF_DANFOSS_ECO_ID): cv.use_id(ConnectionScheduler),
+            cv.Optional(CONF_REGISTRY_SIZE): sensor.sensor_schema(
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_MEASUREMENT,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+            ),
+            cv.Optional(CONF_HIT_RATE): sensor.sensor_schema(
+                unit_of_measurement=UNIT_PERCENT,
+                accuracy_decimals=1,
+                state_class=STATE_CLASS_MEASUREMENT,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+            ),
         }
     )
     .extend(esp32_ble_tracker.ESP_BLE_DEVICE_SCHEMA)
-    .extend(cv.COMPONENT_SCHEMA),
+    .extend(cv.polling_component_schema("60s")),
 )
 
 
@@ -31,3 +53,12 @@ async def to_code(config):
 
     if CONF_READ_SECRET in config:
         cg.add(var.set_read_secret(config[CONF_READ_SECRET]))
+    if CONF_DANFOSS_ECO_ID in config:
+        hub = await cg.get_variable(config[CONF_DANFOSS_ECO_ID])
+        cg.add(var.set_hub(hub))
+    if CONF_REGISTRY_SIZE in config:
+        sens = await sensor.new_sensor(config[CONF_REGISTRY_SIZE])
+        cg.add(var.set_registry_size(sens))
+    if CONF_HIT_RATE in config:
+        sens = await sensor.new_sensor(config[CONF_HIT_RATE])
+        cg.add(var.set_hit_rate(sens))
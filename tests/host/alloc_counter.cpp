@@ -0,0 +1,26 @@
+#include "alloc_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+static uint64_t allocation_count = 0;
+
+void *operator new(std::size_t size)
+{
+    allocation_count++;
+    void *ptr = malloc(size > 0 ? size : 1);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { free(ptr); }
+
+namespace esphome
+{
+    namespace host
+    {
+        uint64_t allocations() { return allocation_count; }
+    } // namespace host
+} // namespace esphome
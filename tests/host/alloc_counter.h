@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome
+{
+    namespace host
+    {
+        // Heap allocations made by the program so far, available to the executables linking alloc_counter.cpp
+        // (it replaces the global operator new).
+        uint64_t allocations();
+    } // namespace host
+} // namespace esphome
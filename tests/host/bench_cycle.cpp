@@ -0,0 +1,100 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "testbed.h"
+#include "alloc_counter.h"
+
+using namespace esphome;
+using namespace esphome::danfoss_eco;
+using namespace esphome::host;
+
+// Drives full poll cycles of several eTRVs through the scheduler and reports the phase latencies,
+// as the devices publish them, plus the host CPU time spent per cycle and the heap allocations after the first polls.
+//
+//   bench_cycle [--devices N] [--minutes M] [--max-connections N] [--response-latency MS]
+int main(int argc, char **argv)
+{
+    int devices = 4;
+    uint32_t minutes = 60;
+    int max_connections = 2;
+    uint32_t response_latency = 60;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--devices") == 0)
+            devices = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--minutes") == 0)
+            minutes = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--max-connections") == 0)
+            max_connections = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--response-latency") == 0)
+            response_latency = atoi(argv[i + 1]);
+    }
+
+    // in LatencyMetric order, polls do not write
+    static const char *const METRICS[] = {"connect", "discovery", "pin", "read"};
+    static constexpr uint8_t METRIC_COUNT = sizeof(METRICS) / sizeof(METRICS[0]);
+    char names[16][16];
+
+    Testbed bed;
+    bed.scheduler.set_max_connections(max_connections);
+    sensor::Sensor *p50[16][METRIC_COUNT];
+    sensor::Sensor *p95[16][METRIC_COUNT];
+    sensor::Sensor *cycles[16];
+    devices = devices < 1 ? 1 : (devices > 16 ? 16 : devices);
+    for (int d = 0; d < devices; d++)
+    {
+        snprintf(names[d], sizeof(names[d]), "etrv_%d", d);
+        Radiator *r = bed.add(names[d]);
+        r->peer.response_latency = response_latency;
+        for (uint8_t m = 0; m < METRIC_COUNT; m++)
+        {
+            p50[d][m] = r->latency((LatencyMetric)m, LatencyStat::P50);
+            p95[d][m] = r->latency((LatencyMetric)m, LatencyStat::P95);
+        }
+        cycles[d] = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    }
+    bed.setup();
+
+    // first polls resolve the handles and the poll phases of the devices
+    uint32_t warm_up = 2 * bed.radiators[0]->device.get_update_interval();
+    run_for(warm_up);
+    uint64_t allocated = allocations();
+
+    auto started = std::chrono::steady_clock::now();
+    run_for(minutes * 60000);
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+    uint32_t loops = minutes * 60000 / LOOP_INTERVAL;
+    allocated = allocations() - allocated;
+
+    uint32_t total_cycles = 0, requests = 0;
+    for (int d = 0; d < devices; d++)
+    {
+        total_cycles += std::isnan(cycles[d]->state) ? 0 : (uint32_t)cycles[d]->state;
+        requests += bed.radiators[d]->peer.requests;
+    }
+
+    printf("%d devices, %u simulated minutes, max %d connections, %u ms per ATT response\n", devices, (unsigned)minutes, max_connections, (unsigned)response_latency);
+    printf("%-12s %10s %10s\n", "phase", "p50 ms", "p95 ms");
+    for (uint8_t m = 0; m < METRIC_COUNT; m++)
+    {
+        float a = 0, b = 0;
+        int n = 0;
+        for (int d = 0; d < devices; d++)
+        {
+            if (std::isnan(p50[d][m]->state))
+                continue;
+            a += p50[d][m]->state;
+            b += p95[d][m]->state;
+            n++;
+        }
+        if (n > 0)
+            printf("%-12s %10.0f %10.0f\n", METRICS[m], a / n, b / n);
+    }
+    printf("cycles: %u, ATT requests per cycle: %.1f\n", (unsigned)total_cycles, total_cycles ? (float)requests / total_cycles : 0.0f);
+    // mostly idle loop() calls, the same ones the firmware runs between the cycles
+    printf("host time: %.1f ms total, %.0f ns per loop() of all components\n", elapsed / 1e6, (double)elapsed / loops);
+    printf("heap allocations after the first polls: %llu\n", (unsigned long long)allocated);
+    return total_cycles > 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+#include "helpers.h"
+
+using namespace esphome::danfoss_eco;
+
+static volatile uint8_t sink;
+
+template <typename F>
+static double measure(uint32_t iterations, uint8_t *value, F &&f)
+{
+    auto started = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        f(value);
+        value[0] ^= i; // keep the calls dependent on each other
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+    sink = value[0];
+    return (double)elapsed / iterations;
+}
+
+// ns per call of the value sizes used by the eTRV, fast path (encrypt()/decrypt()) against the generic one
+// (reverse_chunks() + Xxtea::encrypt()/decrypt() + reverse_chunks()).
+//
+//   bench_xxtea [--iterations N]
+int main(int argc, char **argv)
+{
+    uint32_t iterations = 1000000;
+    for (int i = 1; i + 1 < argc; i += 2)
+        if (strcmp(argv[i], "--iterations") == 0)
+            iterations = atoi(argv[i + 1]);
+
+    static const uint8_t KEY[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+    Xxtea xxtea;
+    xxtea.set_key(KEY, sizeof(KEY));
+
+    printf("%u iterations\n", (unsigned)iterations);
+    printf("%-6s %12s %12s %12s %12s\n", "bytes", "encrypt ns", "generic ns", "decrypt ns", "generic ns");
+    for (uint16_t len : {8, 16})
+    {
+        uint8_t value[MAX_ENCRYPTED_LENGTH] = {};
+        uint8_t plain[MAX_ENCRYPTED_LENGTH];
+
+        double fast_encrypt = measure(iterations, value, [&](uint8_t *v)
+                                      { encrypt(xxtea, v, len); });
+        double generic_encrypt = measure(iterations, value, [&](uint8_t *v)
+                                         {
+                                             uint8_t buffer[MAX_ENCRYPTED_LENGTH];
+                                             reverse_chunks(v, len, buffer);
+                                             xxtea.encrypt(buffer, len);
+                                             reverse_chunks(buffer, len, v); });
+        double fast_decrypt = measure(iterations, value, [&](uint8_t *v)
+                                      {
+                                          decrypt(xxtea, v, len, plain);
+                                          v[1] ^= plain[0]; });
+        double generic_decrypt = measure(iterations, value, [&](uint8_t *v)
+                                         {
+                                             uint8_t buffer[MAX_ENCRYPTED_LENGTH];
+                                             reverse_chunks(v, len, buffer);
+                                             xxtea.decrypt(buffer, len);
+                                             reverse_chunks(buffer, len, plain);
+                                             v[1] ^= plain[0]; });
+        printf("%-6u %12.1f %12.1f %12.1f %12.1f\n", (unsigned)len, fast_encrypt, generic_encrypt, fast_decrypt, generic_decrypt);
+    }
+    return 0;
+}
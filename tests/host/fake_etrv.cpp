@@ -0,0 +1,181 @@
+#include "fake_etrv.h"
+
+#include <cstring>
+
+#include "properties.h"
+
+namespace esphome
+{
+    namespace host
+    {
+        // handles and UUIDs as seen on a Danfoss Eco (firmware 1.1x), UUIDs are the first 32 bits of xxxxxxxx-2749-0001-0000-00805f9b042f
+        const FakeEtrv::Characteristic FakeEtrv::CHARACTERISTICS[] = {
+            {PIN, 0x10020000, 0x10020001, 4, false},
+            {BATTERY, 0x180F, 0x2A19, 1, false},
+            {TEMPERATURE, 0x10020000, 0x10020005, 8, true},
+            {SETTINGS, 0x10020000, 0x10020003, 16, true},
+            {CURRENT_TIME, 0x10020000, 0x10020008, 8, true},
+            {ERRORS, 0x10020000, 0x10020009, 8, true},
+            {SCHEDULE_DAY_SELECT, 0x10020000, 0x10020002, 8, true},
+            {SCHEDULE_DAY, 0x10020000, 0x10020007, 8, true},
+            {SECRET_KEY, 0x10020000, 0x1002000b, 16, false},
+        };
+
+        FakeEtrv::FakeEtrv(const uint8_t *key, uint32_t pin_code) : pin_code(pin_code)
+        {
+            memcpy(this->key_, key, sizeof(this->key_));
+            this->xxtea_.set_key(key, sizeof(this->key_));
+            memset(this->schedule, 0xFF, sizeof(this->schedule));
+        }
+
+        const FakeEtrv::Characteristic *FakeEtrv::find(uint16_t handle) const
+        {
+            for (const auto &chr : CHARACTERISTICS)
+                if (chr.handle == handle)
+                    return &chr;
+            return nullptr;
+        }
+
+        uint16_t FakeEtrv::find_characteristic(const ESPBTUUID &service, const ESPBTUUID &characteristic)
+        {
+            for (const auto &chr : CHARACTERISTICS)
+            {
+                if (chr.handle == SECRET_KEY && !this->secret_key_readable)
+                    continue; // characteristic is exposed only while the button press window is open
+                if (danfoss_eco::to_uuid(chr.service) == service && danfoss_eco::to_uuid(chr.uuid) == characteristic)
+                    return chr.handle;
+            }
+            return 0;
+        }
+
+        static void reverse_words(const uint8_t *in, uint16_t len, uint8_t *out)
+        {
+            for (uint16_t i = 0; i < len; i += 4)
+                for (uint16_t j = 0; j < 4; j++)
+                    out[i + j] = in[i + 3 - j];
+        }
+
+        void FakeEtrv::seal(uint8_t *value, uint16_t len)
+        {
+            uint8_t buff[16];
+            reverse_words(value, len, buff);
+            this->xxtea_.encrypt(buff, len);
+            reverse_words(buff, len, value);
+        }
+
+        void FakeEtrv::open(const uint8_t *value, uint16_t len, uint8_t *plain)
+        {
+            uint8_t buff[16];
+            reverse_words(value, len, buff);
+            this->xxtea_.decrypt(buff, len);
+            reverse_words(buff, len, plain);
+        }
+
+        esp_gatt_status_t FakeEtrv::read(uint16_t handle, uint8_t *value, uint16_t *value_len)
+        {
+            const Characteristic *chr = this->find(handle);
+            if (chr == nullptr)
+                return ESP_GATT_INVALID_HANDLE;
+            if (!this->authenticated_ && handle != BATTERY)
+                return ESP_GATT_INSUF_AUTHENTICATION;
+
+            memset(value, 0, chr->length);
+            switch (handle)
+            {
+            case PIN:
+                return ESP_GATT_READ_NOT_PERMIT;
+            case BATTERY:
+                value[0] = this->battery;
+                break;
+            case TEMPERATURE:
+                value[0] = this->target_half_degrees;
+                value[1] = this->room_half_degrees;
+                break;
+            case SETTINGS:
+                memcpy(value, this->settings, sizeof(this->settings));
+                break;
+            case CURRENT_TIME:
+                danfoss_eco::write_int(value, 0, this->time_local);
+                danfoss_eco::write_int(value, 4, this->time_offset);
+                break;
+            case ERRORS:
+                value[0] = this->errors >> 8;
+                value[1] = this->errors;
+                break;
+            case SCHEDULE_DAY_SELECT:
+                value[0] = this->selected_day_;
+                break;
+            case SCHEDULE_DAY:
+                memcpy(value, this->schedule[this->selected_day_], 8);
+                break;
+            case SECRET_KEY:
+                if (!this->secret_key_readable)
+                    return ESP_GATT_READ_NOT_PERMIT;
+                memcpy(value, this->key_, sizeof(this->key_));
+                break;
+            }
+
+            if (chr->encrypted)
+                this->seal(value, chr->length);
+            *value_len = chr->length;
+            return ESP_GATT_OK;
+        }
+
+        esp_gatt_status_t FakeEtrv::write(uint16_t handle, const uint8_t *value, uint16_t value_len)
+        {
+            const Characteristic *chr = this->find(handle);
+            if (chr == nullptr)
+                return ESP_GATT_INVALID_HANDLE;
+            if (value_len != chr->length)
+                return ESP_GATT_INVALID_ATTR_LEN;
+            if (handle == this->fail_handle_)
+            {
+                this->fail_handle_ = 0;
+                return this->fail_status_;
+            }
+
+            if (handle == PIN)
+            {
+                this->authenticated_ = danfoss_eco::parse_int(value, 0) == this->pin_code;
+                return this->authenticated_ ? ESP_GATT_OK : ESP_GATT_ERROR;
+            }
+            if (!this->authenticated_)
+                return ESP_GATT_INSUF_AUTHENTICATION;
+
+            uint8_t plain[16];
+            if (chr->encrypted)
+                this->open(value, value_len, plain);
+            else
+                memcpy(plain, value, value_len);
+
+            switch (handle)
+            {
+            case TEMPERATURE:
+                this->target_half_degrees = plain[0];
+                this->temperature_writes++;
+                break;
+            case SETTINGS:
+                memcpy(this->settings, plain, sizeof(this->settings));
+                this->settings_writes++;
+                break;
+            case CURRENT_TIME:
+                this->time_local = danfoss_eco::parse_int(plain, 0);
+                this->time_offset = danfoss_eco::parse_int(plain, 4);
+                this->time_writes++;
+                break;
+            case SCHEDULE_DAY_SELECT:
+                if (plain[0] >= 7)
+                    return ESP_GATT_ERROR;
+                this->selected_day_ = plain[0];
+                break;
+            case SCHEDULE_DAY:
+                memcpy(this->schedule[this->selected_day_], plain, 8);
+                this->schedule_writes++;
+                break;
+            default:
+                return ESP_GATT_WRITE_NOT_PERMIT;
+            }
+            return ESP_GATT_OK;
+        }
+    } // namespace host
+} // namespace esphome
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "host.h"
+#include "xxtea.h"
+
+namespace esphome
+{
+    namespace host
+    {
+        // Simulated Danfoss Eco eTRV: characteristics at the handles of a real device, values are encrypted with
+        // the reference XXTEA path (byte order reversed per word, Xxtea::encrypt), PIN must be written first.
+        class FakeEtrv : public Peer
+        {
+        public:
+            static constexpr uint16_t PIN = 0x24;
+            static constexpr uint16_t BATTERY = 0x10;
+            static constexpr uint16_t TEMPERATURE = 0x2d;
+            static constexpr uint16_t SETTINGS = 0x2a;
+            static constexpr uint16_t CURRENT_TIME = 0x36;
+            static constexpr uint16_t ERRORS = 0x39;
+            static constexpr uint16_t SCHEDULE_DAY_SELECT = 0x27;
+            static constexpr uint16_t SCHEDULE_DAY = 0x33;
+            static constexpr uint16_t SECRET_KEY = 0x3f;
+
+            FakeEtrv(const uint8_t *key, uint32_t pin_code);
+
+            uint16_t find_characteristic(const ESPBTUUID &service, const ESPBTUUID &characteristic) override;
+            esp_gatt_status_t read(uint16_t handle, uint8_t *value, uint16_t *value_len) override;
+            esp_gatt_status_t write(uint16_t handle, const uint8_t *value, uint16_t value_len) override;
+            void on_connect() override { this->authenticated_ = false; }
+
+            // next write to the handle is rejected with the status
+            void fail_next_write(uint16_t handle, esp_gatt_status_t status)
+            {
+                this->fail_handle_ = handle;
+                this->fail_status_ = status;
+            }
+
+            // device state, in the units of the wire format
+            uint8_t battery{87};
+            uint8_t target_half_degrees{42}; // 21°C
+            uint8_t room_half_degrees{39};   // 19.5°C
+            uint8_t settings[16]{0x40, 10, 56, 12, 0 /* manual */, 30};
+            uint16_t errors{0};
+            int32_t time_local{0};
+            int32_t time_offset{0};
+            uint8_t schedule[7][8];
+            bool secret_key_readable{false}; // hardware button was pressed
+            uint32_t pin_code;
+
+            // writes, accepted by the device
+            uint32_t temperature_writes{0};
+            uint32_t settings_writes{0};
+            uint32_t schedule_writes{0};
+            uint32_t time_writes{0};
+
+        protected:
+            struct Characteristic
+            {
+                uint16_t handle;
+                uint32_t service;
+                uint32_t uuid;
+                uint16_t length;
+                bool encrypted;
+            };
+            static const Characteristic CHARACTERISTICS[];
+
+            const Characteristic *find(uint16_t handle) const;
+            void seal(uint8_t *value, uint16_t len);
+            void open(const uint8_t *value, uint16_t len, uint8_t *plain);
+
+            uint8_t key_[16];
+            Xxtea xxtea_;
+            bool authenticated_{false};
+            uint8_t selected_day_{0};
+            uint16_t fail_handle_{0};
+            esp_gatt_status_t fail_status_{ESP_GATT_OK};
+        };
+    } // namespace host
+} // namespace esphome
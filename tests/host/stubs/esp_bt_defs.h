@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+#define ESP_BD_ADDR_LEN 6
+typedef uint8_t esp_bd_addr_t[ESP_BD_ADDR_LEN];
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "esp_bt_defs.h"
+
+typedef enum
+{
+    ESP_BT_STATUS_SUCCESS = 0,
+    ESP_BT_STATUS_FAIL = 1
+} esp_bt_status_t;
+
+typedef enum
+{
+    ESP_GAP_BLE_SCAN_RESULT_EVT = 3,
+    ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT = 20
+} esp_gap_ble_cb_event_t;
+
+typedef struct
+{
+    esp_bd_addr_t bda;
+    uint16_t min_int;
+    uint16_t max_int;
+    uint16_t latency;
+    uint16_t timeout;
+} esp_ble_conn_update_params_t;
+
+typedef union
+{
+    struct ble_update_conn_params_evt_param
+    {
+        esp_bt_status_t status;
+        esp_bd_addr_t bda;
+        uint16_t min_int;
+        uint16_t max_int;
+        uint16_t latency;
+        uint16_t conn_int;
+        uint16_t timeout;
+    } update_conn_params;
+} esp_ble_gap_cb_param_t;
+
+// answered with ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, see BLEClient::update_conn_params()
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    namespace binary_sensor
+    {
+        class BinarySensor : public EntityBase
+        {
+        public:
+            void publish_state(bool state)
+            {
+                this->state = state;
+                this->publish_count++;
+            }
+
+            bool state{false};
+            uint32_t publish_count{0};
+        };
+    } // namespace binary_sensor
+} // namespace esphome
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "esphome/components/esp32_ble_tracker/esp32_ble_tracker.h"
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    namespace host
+    {
+        class Peer;
+    }
+
+    namespace ble_client
+    {
+        using esp32_ble_tracker::ClientState;
+        using esp32_ble_tracker::ESPBTUUID;
+
+        class BLEClient;
+
+        class BLECharacteristic
+        {
+        public:
+            uint16_t handle;
+        };
+
+        class BLEClientNode
+        {
+        public:
+            virtual ~BLEClientNode() = default;
+
+            virtual void gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp_ble_gattc_cb_param_t *param) = 0;
+            virtual void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {}
+
+            BLEClient *parent() { return this->parent_; }
+            void set_ble_client_parent(BLEClient *parent) { this->parent_ = parent; }
+
+        protected:
+            BLEClient *parent_{nullptr};
+            ClientState node_state{ClientState::IDLE};
+        };
+
+        // Same contract as the ESPHome ble_client: events of the connection are delivered to the registered nodes,
+        // GATT requests are answered by the simulated peer after its latency (see host.h).
+        // While enabled, the client connects on its own as soon as the peer advertises, like the tracker does.
+        class BLEClient : public Component
+        {
+        public:
+            void setup() override;
+            void loop() override;
+            float get_setup_priority() const override { return setup_priority::AFTER_BLUETOOTH; }
+
+            void set_address(uint64_t address);
+            uint64_t get_address() const { return this->address_; }
+            uint8_t *get_remote_bda() { return this->remote_bda_; }
+            std::string address_str() const { return this->address_str_; }
+
+            void register_ble_node(BLEClientNode *node)
+            {
+                node->set_ble_client_parent(this);
+                this->nodes_.push_back(node);
+            }
+
+            void set_enabled(bool enabled);
+            void connect();
+            void disconnect();
+
+            esp_gatt_if_t get_gattc_if() const { return this->gattc_if_; }
+            uint16_t get_conn_id() const { return this->conn_id_; }
+            ClientState state() const { return this->state_; }
+
+            BLECharacteristic *get_characteristic(ESPBTUUID service, ESPBTUUID characteristic);
+
+            bool enabled{true};
+
+            // host only
+            void set_peer(host::Peer *peer) { this->peer_ = peer; }
+            host::Peer *peer() { return this->peer_; }
+            void set_conn_id(uint16_t conn_id);
+            // link is terminated by the peer (i.e. it went out of range)
+            void drop_link();
+            bool is_connected() const;
+            void deliver(esp_gattc_cb_event_t event, esp_ble_gattc_cb_param_t *param);
+            void deliver(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+
+        protected:
+            uint64_t address_{0};
+            esp_bd_addr_t remote_bda_{0};
+            std::string address_str_;
+            std::vector<BLEClientNode *> nodes_;
+            ClientState state_{ClientState::IDLE};
+            esp_gatt_if_t gattc_if_{0};
+            uint16_t conn_id_{0};
+            BLECharacteristic characteristic_{};
+            host::Peer *peer_{nullptr};
+        };
+    } // namespace ble_client
+} // namespace esphome
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cmath>
+#include <set>
+
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+
+namespace esphome
+{
+    namespace climate
+    {
+        enum ClimateMode : uint8_t
+        {
+            CLIMATE_MODE_OFF = 0,
+            CLIMATE_MODE_HEAT_COOL = 1,
+            CLIMATE_MODE_COOL = 2,
+            CLIMATE_MODE_HEAT = 3,
+            CLIMATE_MODE_FAN_ONLY = 4,
+            CLIMATE_MODE_DRY = 5,
+            CLIMATE_MODE_AUTO = 6
+        };
+
+        enum ClimateAction : uint8_t
+        {
+            CLIMATE_ACTION_OFF = 0,
+            CLIMATE_ACTION_COOLING = 2,
+            CLIMATE_ACTION_HEATING = 3,
+            CLIMATE_ACTION_IDLE = 4
+        };
+
+        class ClimateTraits
+        {
+        public:
+            void set_supports_current_temperature(bool supports) { this->supports_current_temperature_ = supports; }
+            void set_supports_action(bool supports) { this->supports_action_ = supports; }
+            void set_supported_modes(std::set<ClimateMode> modes) { this->supported_modes_ = std::move(modes); }
+            void set_visual_temperature_step(float step) { this->visual_temperature_step_ = step; }
+            void set_visual_min_temperature(float min) { this->visual_min_temperature_ = min; }
+            void set_visual_max_temperature(float max) { this->visual_max_temperature_ = max; }
+
+        protected:
+            bool supports_current_temperature_{false};
+            bool supports_action_{false};
+            std::set<ClimateMode> supported_modes_;
+            float visual_temperature_step_{0.1f};
+            float visual_min_temperature_{10};
+            float visual_max_temperature_{30};
+        };
+
+        class Climate;
+
+        class ClimateCall
+        {
+        public:
+            explicit ClimateCall(Climate *parent) : parent_(parent) {}
+
+            ClimateCall &set_mode(ClimateMode mode)
+            {
+                this->mode_ = mode;
+                return *this;
+            }
+            ClimateCall &set_mode(optional<ClimateMode> mode)
+            {
+                this->mode_ = mode;
+                return *this;
+            }
+            ClimateCall &set_target_temperature(float target_temperature)
+            {
+                this->target_temperature_ = target_temperature;
+                return *this;
+            }
+
+            const optional<ClimateMode> &get_mode() const { return this->mode_; }
+            const optional<float> &get_target_temperature() const { return this->target_temperature_; }
+
+            void perform();
+
+        protected:
+            Climate *parent_;
+            optional<ClimateMode> mode_;
+            optional<float> target_temperature_;
+        };
+
+        class Climate : public EntityBase
+        {
+        public:
+            ClimateCall make_call() { return ClimateCall(this); }
+            void publish_state() { this->publish_count++; }
+            virtual ClimateTraits traits() = 0;
+
+            void set_visual_min_temperature_override(float min) { this->visual_min_temperature_override_ = min; }
+            void set_visual_max_temperature_override(float max) { this->visual_max_temperature_override_ = max; }
+
+            ClimateMode mode{CLIMATE_MODE_OFF};
+            ClimateAction action{CLIMATE_ACTION_OFF};
+            float current_temperature{NAN};
+            float target_temperature{NAN};
+            uint32_t publish_count{0};
+
+        protected:
+            friend ClimateCall;
+            virtual void control(const ClimateCall &call) = 0;
+
+            optional<float> visual_min_temperature_override_;
+            optional<float> visual_max_temperature_override_;
+        };
+
+        inline void ClimateCall::perform() { this->parent_->control(*this); }
+    } // namespace climate
+} // namespace esphome
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "esphome/core/component.h"
+
+#include <esp_gap_ble_api.h>
+#include <esp_gattc_api.h>
+
+namespace esphome
+{
+    namespace esp32_ble_tracker
+    {
+        enum class ClientState : uint8_t
+        {
+            INIT = 0,
+            DISCONNECTING,
+            IDLE,
+            DISCOVERED,
+            READY_TO_CONNECT,
+            CONNECTING,
+            CONNECTED,
+            ESTABLISHED
+        };
+
+        // 128 bit UUID, little-endian, as the ESP-IDF keeps it
+        class ESPBTUUID
+        {
+        public:
+            static ESPBTUUID from_uint16(uint16_t uuid);
+            static ESPBTUUID from_uint32(uint32_t uuid);
+            static ESPBTUUID from_raw(const uint8_t *data);
+
+            bool operator==(const ESPBTUUID &other) const;
+
+        protected:
+            uint8_t raw_[16]{0};
+        };
+
+        class ESPBTDevice
+        {
+        public:
+            ESPBTDevice(uint64_t address, const std::string &name, int rssi) : address_(address), name_(name), rssi_(rssi) {}
+
+            uint64_t address_uint64() const { return this->address_; }
+            const std::string &get_name() const { return this->name_; }
+            int get_rssi() const { return this->rssi_; }
+            // host only: signal of the peer could change during the test
+            void set_rssi(int rssi) { this->rssi_ = rssi; }
+
+        protected:
+            uint64_t address_;
+            std::string name_;
+            int rssi_;
+        };
+
+        class ESPBTDeviceListener
+        {
+        public:
+            virtual ~ESPBTDeviceListener() = default;
+            virtual bool parse_device(const ESPBTDevice &device) = 0;
+        };
+
+        // passes the advertisements of the simulated peers, which are in range, to the listeners
+        class ESP32BLETracker : public Component
+        {
+        public:
+            void loop() override;
+            float get_setup_priority() const override { return setup_priority::BLUETOOTH; }
+
+            void register_listener(ESPBTDeviceListener *listener) { this->listeners_.push_back(listener); }
+
+        protected:
+            static constexpr uint8_t MAX_ADVERTISERS = 16;
+
+            std::vector<ESPBTDeviceListener *> listeners_;
+            // built once per peer, so the scan does not allocate
+            std::unique_ptr<ESPBTDevice> advertisements_[MAX_ADVERTISERS];
+            uint32_t next_advertisement_[MAX_ADVERTISERS]{0};
+        };
+    } // namespace esp32_ble_tracker
+} // namespace esphome
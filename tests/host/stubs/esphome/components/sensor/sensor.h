@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cmath>
+
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    namespace sensor
+    {
+        class Sensor : public EntityBase
+        {
+        public:
+            void publish_state(float state)
+            {
+                this->state = state;
+                this->publish_count++;
+            }
+
+            float state{NAN};
+            uint32_t publish_count{0};
+        };
+    } // namespace sensor
+} // namespace esphome
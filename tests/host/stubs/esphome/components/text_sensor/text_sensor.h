@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    namespace text_sensor
+    {
+        class TextSensor : public EntityBase
+        {
+        public:
+            void publish_state(const std::string &state)
+            {
+                this->state = state;
+                this->publish_count++;
+            }
+
+            std::string state;
+            uint32_t publish_count{0};
+        };
+    } // namespace text_sensor
+} // namespace esphome
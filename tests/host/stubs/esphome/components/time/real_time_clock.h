@@ -0,0 +1,44 @@
+#pragma once
+
+#include <ctime>
+
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    struct ESPTime
+    {
+        time_t timestamp;
+
+        bool is_valid() const { return this->timestamp > 0; }
+        // offset of the local time from UTC, seconds (host::set_timezone_offset)
+        static int32_t timezone_offset();
+    };
+
+    namespace time
+    {
+        // time source: UTC starts at the given timestamp and follows millis()
+        class RealTimeClock : public Component
+        {
+        public:
+            void set_utc(time_t utc)
+            {
+                this->utc_ = utc;
+                this->set_at_ = millis();
+            }
+
+            ESPTime utcnow() const { return ESPTime{this->utc_ == 0 ? 0 : this->utc_ + (time_t)((millis() - this->set_at_) / 1000)}; }
+            ESPTime now() const
+            {
+                ESPTime t = this->utcnow();
+                if (t.is_valid())
+                    t.timestamp += ESPTime::timezone_offset();
+                return t;
+            }
+
+        protected:
+            time_t utc_{0};
+            uint32_t set_at_{0};
+        };
+    } // namespace time
+} // namespace esphome
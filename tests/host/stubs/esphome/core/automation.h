@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+    template <typename... Ts>
+    class Trigger
+    {
+    public:
+        void trigger(Ts... x)
+        {
+            if (this->callback_)
+                this->callback_(x...);
+        }
+        // host only: stands for the automation attached to the trigger
+        void set_callback(std::function<void(Ts...)> &&callback) { this->callback_ = std::move(callback); }
+
+    protected:
+        std::function<void(Ts...)> callback_;
+    };
+
+    template <typename... Ts>
+    class Action
+    {
+    public:
+        virtual ~Action() = default;
+        virtual void play(Ts... x) = 0;
+    };
+
+    template <typename T, typename... X>
+    class TemplatableValue
+    {
+    public:
+        TemplatableValue() {}
+        TemplatableValue(T value) : value_(value), has_value_(true) {}
+
+        bool has_value() const { return this->has_value_; }
+        T value(X...) { return this->value_; }
+
+    protected:
+        T value_{};
+        bool has_value_{false};
+    };
+} // namespace esphome
+
+#define TEMPLATABLE_VALUE_(type, name)                               \
+protected:                                                           \
+    TemplatableValue<type, Ts...> name##_{};                         \
+                                                                     \
+public:                                                              \
+    template <typename V>                                            \
+    void set_##name(V name) { this->name##_ = TemplatableValue<type, Ts...>(name); }
+
+#define TEMPLATABLE_VALUE(type, name) TEMPLATABLE_VALUE_(type, name)
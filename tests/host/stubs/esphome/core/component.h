@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+
+namespace esphome
+{
+    namespace setup_priority
+    {
+        const float BUS = 1000.0f;
+        const float IO = 900.0f;
+        const float HARDWARE = 800.0f;
+        const float DATA = 600.0f;
+        const float PROCESSOR = 400.0f;
+        const float BLUETOOTH = 350.0f;
+        const float AFTER_BLUETOOTH = 300.0f;
+        const float WIFI = 250.0f;
+        const float LATE = -100.0f;
+    } // namespace setup_priority
+
+    class Component
+    {
+    public:
+        virtual ~Component() = default;
+
+        virtual void setup() {}
+        virtual void loop() {}
+        virtual void dump_config() {}
+        virtual float get_setup_priority() const { return setup_priority::DATA; }
+
+        bool status_has_error() const { return this->error_; }
+        void status_set_error() { this->error_ = true; }
+        void status_clear_error() { this->error_ = false; }
+        void mark_failed() { this->failed_ = true; }
+        bool is_failed() const { return this->failed_; }
+
+    protected:
+        bool error_{false};
+        bool failed_{false};
+    };
+
+    // update() is called by the host loop (see host.h), once the interval has elapsed
+    class PollingComponent : public Component
+    {
+    public:
+        PollingComponent() {}
+        explicit PollingComponent(uint32_t update_interval) : update_interval_(update_interval) {}
+
+        virtual void update() = 0;
+        virtual void set_update_interval(uint32_t update_interval) { this->update_interval_ = update_interval; }
+        virtual uint32_t get_update_interval() const { return this->update_interval_; }
+
+        void start_poller();
+        void stop_poller() { this->poller_running_ = false; }
+
+        bool poller_running() const { return this->poller_running_; }
+        uint32_t next_update() const { return this->next_update_; }
+        void poll_done(uint32_t now) { this->next_update_ = now + this->update_interval_; }
+
+    protected:
+        uint32_t update_interval_{60000};
+        bool poller_running_{false};
+        uint32_t next_update_{0};
+    };
+
+    class EntityBase
+    {
+    public:
+        const std::string &get_name() const { return this->name_; }
+        void set_name(const char *name) { this->name_ = name; }
+        uint32_t get_object_id_hash();
+
+    protected:
+        std::string name_;
+    };
+} // namespace esphome
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome
+{
+    // simulated clock, advanced by the host loop (see host.h)
+    uint32_t millis();
+    uint32_t micros();
+    void delay(uint32_t ms);
+} // namespace esphome
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#define YESNO(b) ((b) ? "YES" : "NO")
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+namespace esphome
+{
+    template <typename T>
+    using optional = std::optional<T>;
+
+    template <typename T>
+    class Parented
+    {
+    public:
+        Parented() {}
+        Parented(T *parent) : parent_(parent) {}
+
+        T *get_parent() const { return this->parent_; }
+        void set_parent(T *parent) { this->parent_ = parent; }
+
+    protected:
+        T *parent_{nullptr};
+    };
+
+    template <typename... X>
+    class CallbackManager;
+
+    template <typename... Ts>
+    class CallbackManager<void(Ts...)>
+    {
+    public:
+        void add(std::function<void(Ts...)> &&callback) { this->callbacks_.push_back(std::move(callback)); }
+        void call(Ts... args)
+        {
+            for (auto &cb : this->callbacks_)
+                cb(args...);
+        }
+
+    protected:
+        std::vector<std::function<void(Ts...)>> callbacks_;
+    };
+
+    uint32_t fnv1_hash(const std::string &str);
+    std::string format_hex_pretty(const uint8_t *data, size_t length);
+    // deterministic on the host, so the runs can be compared
+    uint32_t random_uint32();
+} // namespace esphome
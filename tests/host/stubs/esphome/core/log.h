@@ -0,0 +1,38 @@
+#pragma once
+
+#include "esphome/core/helpers.h"
+
+#define ESPHOME_LOG_LEVEL_NONE 0
+#define ESPHOME_LOG_LEVEL_ERROR 1
+#define ESPHOME_LOG_LEVEL_WARN 2
+#define ESPHOME_LOG_LEVEL_INFO 3
+#define ESPHOME_LOG_LEVEL_CONFIG 4
+#define ESPHOME_LOG_LEVEL_DEBUG 5
+
+namespace esphome
+{
+    // prints the message, if the level is enabled by host::set_log_level()
+    void esp_log_printf_(int level, const char *tag, int line, const char *format, ...);
+} // namespace esphome
+
+#define ESP_LOGE(tag, ...) ::esphome::esp_log_printf_(ESPHOME_LOG_LEVEL_ERROR, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ::esphome::esp_log_printf_(ESPHOME_LOG_LEVEL_WARN, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ::esphome::esp_log_printf_(ESPHOME_LOG_LEVEL_INFO, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ::esphome::esp_log_printf_(ESPHOME_LOG_LEVEL_CONFIG, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ::esphome::esp_log_printf_(ESPHOME_LOG_LEVEL_DEBUG, tag, __LINE__, __VA_ARGS__)
+// compiled out, as in the firmware built with the default DEBUG log level
+#define ESP_LOGV(tag, ...) \
+    do                     \
+    {                      \
+    } while (0)
+#define ESP_LOGVV(tag, ...) \
+    do                      \
+    {                       \
+    } while (0)
+
+#define LOG_SENSOR(prefix, type, obj) (void)(obj)
+#define LOG_BINARY_SENSOR(prefix, type, obj) (void)(obj)
+#define LOG_TEXT_SENSOR(prefix, type, obj) (void)(obj)
+#define LOG_CLIMATE(prefix, type, obj) (void)(obj)
+#define LOG_BUTTON(prefix, type, obj) (void)(obj)
+#define LOG_UPDATE_INTERVAL(obj) (void)(obj)
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome
+{
+    // in-memory flash: values survive a re-created component, see host::reset_preferences()
+    class ESPPreferenceObject
+    {
+    public:
+        ESPPreferenceObject() {}
+        ESPPreferenceObject(uint32_t type, size_t length) : type_(type), length_(length) {}
+
+        template <typename T>
+        bool save(const T *src) { return this->save_(reinterpret_cast<const uint8_t *>(src), sizeof(T)); }
+        template <typename T>
+        bool load(T *dest) { return this->load_(reinterpret_cast<uint8_t *>(dest), sizeof(T)); }
+
+    protected:
+        bool save_(const uint8_t *data, size_t length);
+        bool load_(uint8_t *data, size_t length);
+
+        uint32_t type_{0};
+        size_t length_{0};
+    };
+
+    class ESPPreferences
+    {
+    public:
+        template <typename T>
+        ESPPreferenceObject make_preference(uint32_t type, bool in_flash = false) { return this->make_preference_(type, sizeof(T)); }
+        bool sync();
+
+    protected:
+        ESPPreferenceObject make_preference_(uint32_t type, size_t length);
+    };
+
+    extern ESPPreferences *global_preferences;
+} // namespace esphome
@@ -0,0 +1,650 @@
+#include "host.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+#include "esphome/components/time/real_time_clock.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+
+namespace esphome
+{
+    namespace host
+    {
+        uint32_t now_ms = 1000;
+        int log_level = ESPHOME_LOG_LEVEL_WARN;
+        int32_t timezone_offset = 0;
+
+        static std::vector<Component *> components;
+
+        static ble_client::BLEClient *clients[MAX_CLIENTS]{nullptr};
+        static uint8_t clients_registered = 0;
+
+        struct RadioEvent
+        {
+            uint32_t due;
+            uint32_t seq; // events, which are due at the same time, are delivered in the order they were queued
+            ble_client::BLEClient *client;
+            bool gap;
+            esp_gattc_cb_event_t gattc_event;
+            esp_gap_ble_cb_event_t gap_event;
+            esp_ble_gattc_cb_param_t gattc_param;
+            esp_ble_gap_cb_param_t gap_param;
+            uint8_t value[Peer::MAX_VALUE * ESP_GATT_MAX_READ_MULTI_HANDLES];
+            uint16_t value_len;
+        };
+
+        static constexpr uint8_t MAX_EVENTS = 64;
+        static RadioEvent events[MAX_EVENTS];
+        static uint8_t event_count = 0;
+        static uint32_t event_seq = 0;
+
+        struct StoredPreference
+        {
+            std::vector<uint8_t> data;
+            bool written;
+        };
+        std::map<uint32_t, StoredPreference> flash;
+        uint32_t flash_writes = 0;
+
+        void set_log_level(int level) { log_level = level; }
+        void set_timezone_offset(int32_t offset) { timezone_offset = offset; }
+
+        void register_component(Component *component)
+        {
+            components.push_back(component);
+            auto *client = dynamic_cast<ble_client::BLEClient *>(component);
+            if (client != nullptr && clients_registered < MAX_CLIENTS)
+            {
+                client->set_conn_id(clients_registered);
+                clients[clients_registered++] = client;
+            }
+        }
+
+        void setup()
+        {
+            std::stable_sort(components.begin(), components.end(), [](Component *a, Component *b)
+                             { return a->get_setup_priority() > b->get_setup_priority(); });
+            for (auto *component : components)
+            {
+                component->setup();
+                auto *poller = dynamic_cast<PollingComponent *>(component);
+                if (poller != nullptr)
+                    poller->start_poller();
+            }
+        }
+
+        static bool pop_due_event(RadioEvent &event)
+        {
+            int8_t first = -1;
+            for (uint8_t i = 0; i < event_count; i++)
+            {
+                if ((int32_t)(now_ms - events[i].due) < 0)
+                    continue;
+                if (first < 0 || (int32_t)(events[i].due - events[first].due) < 0 ||
+                    (events[i].due == events[first].due && events[i].seq < events[first].seq))
+                    first = i;
+            }
+            if (first < 0)
+                return false;
+
+            event = events[first];
+            events[first] = events[--event_count];
+            return true;
+        }
+
+        void step()
+        {
+            static RadioEvent event;
+            while (pop_due_event(event))
+            {
+                if (event.gap)
+                {
+                    event.client->deliver(event.gap_event, &event.gap_param);
+                    continue;
+                }
+                if (event.gattc_event == ESP_GATTC_READ_CHAR_EVT || event.gattc_event == ESP_GATTC_READ_MULTIPLE_EVT)
+                {
+                    event.gattc_param.read.value = event.value;
+                    event.gattc_param.read.value_len = event.value_len;
+                }
+                event.client->deliver(event.gattc_event, &event.gattc_param);
+            }
+
+            for (auto *component : components)
+            {
+                if (component->is_failed())
+                    continue;
+                component->loop();
+                auto *poller = dynamic_cast<PollingComponent *>(component);
+                if (poller != nullptr && poller->poller_running() && (int32_t)(now_ms - poller->next_update()) >= 0)
+                {
+                    poller->poll_done(now_ms);
+                    poller->update();
+                }
+            }
+
+            now_ms += LOOP_INTERVAL;
+        }
+
+        void run_for(uint32_t ms)
+        {
+            uint32_t deadline = now_ms + ms;
+            while ((int32_t)(now_ms - deadline) < 0)
+                step();
+        }
+
+        void reset()
+        {
+            components.clear();
+            clients_registered = 0;
+            event_count = 0;
+        }
+
+        void reset_preferences()
+        {
+            flash.clear();
+            flash_writes = 0;
+        }
+
+        uint32_t preference_writes() { return flash_writes; }
+
+        static RadioEvent *new_event(ble_client::BLEClient *client, uint32_t delay)
+        {
+            if (event_count == MAX_EVENTS)
+            {
+                fprintf(stderr, "host: radio event queue overflow\n");
+                abort();
+            }
+            RadioEvent *event = &events[event_count++];
+            event->due = now_ms + delay;
+            event->seq = event_seq++;
+            event->client = client;
+            event->value_len = 0;
+            return event;
+        }
+
+        void queue_event(ble_client::BLEClient *client, uint32_t delay, esp_gattc_cb_event_t type, const esp_ble_gattc_cb_param_t &param,
+                         const uint8_t *value, uint16_t value_len)
+        {
+            RadioEvent *event = new_event(client, delay);
+            event->gap = false;
+            event->gattc_event = type;
+            event->gattc_param = param;
+            if (value_len > sizeof(event->value))
+                value_len = sizeof(event->value);
+            if (value_len > 0)
+                memcpy(event->value, value, value_len);
+            event->value_len = value_len;
+        }
+
+        void queue_event(ble_client::BLEClient *client, uint32_t delay, esp_gap_ble_cb_event_t type, const esp_ble_gap_cb_param_t &param)
+        {
+            RadioEvent *event = new_event(client, delay);
+            event->gap = true;
+            event->gap_event = type;
+            event->gap_param = param;
+        }
+
+        void drop_events(ble_client::BLEClient *client)
+        {
+            for (uint8_t i = 0; i < event_count;)
+            {
+                if (events[i].client == client)
+                    events[i] = events[--event_count];
+                else
+                    i++;
+            }
+        }
+
+        ble_client::BLEClient *find_client(uint16_t conn_id)
+        {
+            for (uint8_t i = 0; i < clients_registered; i++)
+                if (clients[i]->get_conn_id() == conn_id)
+                    return clients[i];
+            return nullptr;
+        }
+
+        uint8_t client_count() { return clients_registered; }
+        ble_client::BLEClient *client(uint8_t index) { return clients[index]; }
+
+        ble_client::BLEClient *find_client(const uint8_t *bda)
+        {
+            for (uint8_t i = 0; i < clients_registered; i++)
+                if (memcmp(clients[i]->get_remote_bda(), bda, ESP_BD_ADDR_LEN) == 0)
+                    return clients[i];
+            return nullptr;
+        }
+    } // namespace host
+
+    // core
+
+    uint32_t millis() { return host::now_ms; }
+    uint32_t micros() { return host::now_ms * 1000; }
+    void delay(uint32_t ms) { host::now_ms += ms; }
+
+    void esp_log_printf_(int level, const char *tag, int line, const char *format, ...)
+    {
+        if (level > host::log_level)
+            return;
+
+        static const char LEVELS[] = "-EWICD";
+        printf("[%7u][%c][%s:%03d]: ", (unsigned)host::now_ms, LEVELS[level], tag, line);
+        va_list args;
+        va_start(args, format);
+        vprintf(format, args);
+        va_end(args);
+        printf("\n");
+    }
+
+    uint32_t fnv1_hash(const std::string &str)
+    {
+        uint32_t hash = 2166136261UL;
+        for (char c : str)
+        {
+            hash *= 16777619UL;
+            hash ^= c;
+        }
+        return hash;
+    }
+
+    std::string format_hex_pretty(const uint8_t *data, size_t length)
+    {
+        std::string ret;
+        char buf[4];
+        for (size_t i = 0; i < length; i++)
+        {
+            snprintf(buf, sizeof(buf), i + 1 < length ? "%02X." : "%02X", data[i]);
+            ret += buf;
+        }
+        return ret;
+    }
+
+    uint32_t random_uint32()
+    {
+        static uint32_t state = 2463534242UL;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    uint32_t EntityBase::get_object_id_hash() { return fnv1_hash(this->name_); }
+
+    void PollingComponent::start_poller()
+    {
+        // first update runs right away, the firmware would pick a random offset within the interval
+        this->poller_running_ = true;
+        this->next_update_ = host::now_ms;
+    }
+
+    // preferences
+
+    static ESPPreferences preferences;
+    ESPPreferences *global_preferences = &preferences;
+
+    ESPPreferenceObject ESPPreferences::make_preference_(uint32_t type, size_t length)
+    {
+        // storage is reserved up front, so save() does not allocate
+        auto &stored = host::flash[type];
+        if (stored.data.size() != length)
+        {
+            stored.data.assign(length, 0);
+            stored.written = false;
+        }
+        return ESPPreferenceObject(type, length);
+    }
+
+    bool ESPPreferences::sync() { return true; }
+
+    bool ESPPreferenceObject::save_(const uint8_t *data, size_t length)
+    {
+        auto it = host::flash.find(this->type_);
+        if (it == host::flash.end() || length != this->length_)
+            return false;
+        memcpy(it->second.data.data(), data, length);
+        it->second.written = true;
+        host::flash_writes++;
+        return true;
+    }
+
+    bool ESPPreferenceObject::load_(uint8_t *data, size_t length)
+    {
+        auto it = host::flash.find(this->type_);
+        if (it == host::flash.end() || !it->second.written || length != this->length_)
+            return false;
+        memcpy(data, it->second.data.data(), length);
+        return true;
+    }
+
+    int32_t ESPTime::timezone_offset() { return host::timezone_offset; }
+
+    // bluetooth
+
+    namespace esp32_ble_tracker
+    {
+        ESPBTUUID ESPBTUUID::from_uint16(uint16_t uuid) { return from_uint32(uuid); }
+
+        ESPBTUUID ESPBTUUID::from_uint32(uint32_t uuid)
+        {
+            // 0000xxxx-0000-1000-8000-00805f9b34fb, little-endian
+            static const uint8_t BASE[16] = {0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00};
+            uint8_t raw[16];
+            memcpy(raw, BASE, sizeof(raw));
+            raw[12] = uuid;
+            raw[13] = uuid >> 8;
+            raw[14] = uuid >> 16;
+            raw[15] = uuid >> 24;
+            return from_raw(raw);
+        }
+
+        ESPBTUUID ESPBTUUID::from_raw(const uint8_t *data)
+        {
+            ESPBTUUID ret;
+            memcpy(ret.raw_, data, sizeof(ret.raw_));
+            return ret;
+        }
+
+        bool ESPBTUUID::operator==(const ESPBTUUID &other) const { return memcmp(this->raw_, other.raw_, sizeof(this->raw_)) == 0; }
+
+        void ESP32BLETracker::loop()
+        {
+            for (uint8_t i = 0; i < host::client_count() && i < MAX_ADVERTISERS; i++)
+            {
+                ble_client::BLEClient *client = host::client(i);
+                host::Peer *peer = client->peer();
+                if (peer == nullptr || !peer->in_range || (int32_t)(millis() - this->next_advertisement_[i]) < 0)
+                    continue;
+                this->next_advertisement_[i] = millis() + peer->advertising_interval;
+
+                // name of an eTRV is "<flags>;<MAC>;eTRV"
+                if (this->advertisements_[i] == nullptr)
+                    this->advertisements_[i].reset(new ESPBTDevice(client->get_address(), "0;" + client->address_str() + ";eTRV", peer->rssi));
+                this->advertisements_[i]->set_rssi(peer->rssi);
+                for (auto *listener : this->listeners_)
+                    listener->parse_device(*this->advertisements_[i]);
+            }
+        }
+    } // namespace esp32_ble_tracker
+
+    namespace ble_client
+    {
+        void BLEClient::setup()
+        {
+            // same as the ESPHome ble_client, whatever the nodes did in their setup()
+            this->enabled = true;
+        }
+
+        void BLEClient::loop()
+        {
+            // tracker connects an enabled client, as soon as it sees the advertisement
+            if (this->enabled && this->state_ == ClientState::IDLE && this->peer_ != nullptr && this->peer_->in_range)
+                this->connect();
+        }
+
+        void BLEClient::set_address(uint64_t address)
+        {
+            this->address_ = address;
+            char buf[18];
+            snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", (uint8_t)(address >> 40), (uint8_t)(address >> 32),
+                     (uint8_t)(address >> 24), (uint8_t)(address >> 16), (uint8_t)(address >> 8), (uint8_t)address);
+            this->address_str_ = buf;
+        }
+
+        void BLEClient::set_conn_id(uint16_t conn_id)
+        {
+            this->conn_id_ = conn_id;
+            this->gattc_if_ = conn_id + 1;
+        }
+
+        void BLEClient::set_enabled(bool enabled)
+        {
+            if (enabled == this->enabled)
+                return;
+            this->enabled = enabled;
+            if (!enabled && this->state_ != ClientState::IDLE)
+                this->disconnect();
+        }
+
+        void BLEClient::connect()
+        {
+            if (this->state_ != ClientState::IDLE || this->peer_ == nullptr)
+                return;
+
+            this->state_ = ClientState::CONNECTING;
+            host::Peer *peer = this->peer_;
+            peer->connection_attempts++;
+
+            esp_ble_gattc_cb_param_t param{};
+            if (!peer->in_range || !peer->accepts_connections)
+            {
+                param.open.status = ESP_GATT_ERROR;
+                param.open.conn_id = this->conn_id_;
+                memcpy(param.open.remote_bda, this->remote_bda_, ESP_BD_ADDR_LEN);
+                host::queue_event(this, peer->open_failure_latency, ESP_GATTC_OPEN_EVT, param);
+                return;
+            }
+
+            param.connect.conn_id = this->conn_id_;
+            memcpy(param.connect.remote_bda, this->remote_bda_, ESP_BD_ADDR_LEN);
+            host::queue_event(this, peer->connect_latency, ESP_GATTC_CONNECT_EVT, param);
+
+            param = {};
+            param.open.status = ESP_GATT_OK;
+            param.open.conn_id = this->conn_id_;
+            param.open.mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+            memcpy(param.open.remote_bda, this->remote_bda_, ESP_BD_ADDR_LEN);
+            host::queue_event(this, peer->connect_latency, ESP_GATTC_OPEN_EVT, param);
+
+            param = {};
+            param.cfg_mtu.status = ESP_GATT_OK;
+            param.cfg_mtu.conn_id = this->conn_id_;
+            param.cfg_mtu.mtu = peer->mtu;
+            host::queue_event(this, peer->connect_latency + peer->response_latency, ESP_GATTC_CFG_MTU_EVT, param);
+
+            param = {};
+            param.search_cmpl.status = ESP_GATT_OK;
+            param.search_cmpl.conn_id = this->conn_id_;
+            host::queue_event(this, peer->connect_latency + peer->discovery_latency, ESP_GATTC_SEARCH_CMPL_EVT, param);
+        }
+
+        void BLEClient::disconnect()
+        {
+            if (this->state_ == ClientState::IDLE || this->state_ == ClientState::DISCONNECTING)
+                return;
+
+            // responses in flight are lost with the link
+            host::drop_events(this);
+            this->state_ = ClientState::DISCONNECTING;
+
+            esp_ble_gattc_cb_param_t param{};
+            param.disconnect.reason = 0x16; // terminated by the local host
+            param.disconnect.conn_id = this->conn_id_;
+            memcpy(param.disconnect.remote_bda, this->remote_bda_, ESP_BD_ADDR_LEN);
+            host::queue_event(this, this->peer_->disconnect_latency, ESP_GATTC_DISCONNECT_EVT, param);
+
+            param = {};
+            param.close.status = ESP_GATT_OK;
+            param.close.conn_id = this->conn_id_;
+            memcpy(param.close.remote_bda, this->remote_bda_, ESP_BD_ADDR_LEN);
+            host::queue_event(this, this->peer_->disconnect_latency, ESP_GATTC_CLOSE_EVT, param);
+        }
+
+        void BLEClient::drop_link()
+        {
+            if (this->state_ == ClientState::IDLE)
+                return;
+
+            host::drop_events(this);
+            this->state_ = ClientState::DISCONNECTING;
+            esp_ble_gattc_cb_param_t param{};
+            param.disconnect.reason = 0x08; // supervision timeout
+            param.disconnect.conn_id = this->conn_id_;
+            memcpy(param.disconnect.remote_bda, this->remote_bda_, ESP_BD_ADDR_LEN);
+            host::queue_event(this, 0, ESP_GATTC_DISCONNECT_EVT, param);
+        }
+
+        BLECharacteristic *BLEClient::get_characteristic(ESPBTUUID service, ESPBTUUID characteristic)
+        {
+            if (this->state_ != ClientState::ESTABLISHED || this->peer_ == nullptr)
+                return nullptr;
+
+            uint16_t handle = this->peer_->find_characteristic(service, characteristic);
+            if (handle == 0)
+                return nullptr;
+            this->characteristic_.handle = handle;
+            return &this->characteristic_;
+        }
+
+        bool BLEClient::is_connected() const
+        {
+            return this->state_ == ClientState::CONNECTED || this->state_ == ClientState::ESTABLISHED;
+        }
+
+        void BLEClient::deliver(esp_gattc_cb_event_t event, esp_ble_gattc_cb_param_t *param)
+        {
+            switch (event)
+            {
+            case ESP_GATTC_OPEN_EVT:
+                if (param->open.status == ESP_GATT_OK)
+                {
+                    this->state_ = ClientState::CONNECTED;
+                    this->peer_->connections++;
+                    this->peer_->on_connect();
+                }
+                else
+                    this->state_ = ClientState::IDLE;
+                break;
+            case ESP_GATTC_SEARCH_CMPL_EVT:
+                this->state_ = ClientState::ESTABLISHED;
+                break;
+            case ESP_GATTC_DISCONNECT_EVT:
+                this->state_ = ClientState::IDLE;
+                this->peer_->on_disconnect();
+                break;
+            default:
+                break;
+            }
+
+            for (auto *node : this->nodes_)
+                node->gattc_event_handler(event, this->gattc_if_, param);
+        }
+
+        void BLEClient::deliver(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+        {
+            for (auto *node : this->nodes_)
+                node->gap_event_handler(event, param);
+        }
+    } // namespace ble_client
+} // namespace esphome
+
+using esphome::ble_client::BLEClient;
+using esphome::host::Peer;
+
+static BLEClient *connected_client(esp_gatt_if_t gattc_if, uint16_t conn_id)
+{
+    BLEClient *client = esphome::host::find_client(conn_id);
+    if (client == nullptr || client->get_gattc_if() != gattc_if || !client->is_connected())
+        return nullptr;
+    return client;
+}
+
+// link stays up, the response is lost in the air
+static bool response_lost(Peer *peer)
+{
+    if (peer->lost_responses == 0)
+        return false;
+    peer->lost_responses--;
+    return true;
+}
+
+esp_err_t esp_ble_gattc_read_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle, esp_gatt_auth_req_t auth_req)
+{
+    BLEClient *client = connected_client(gattc_if, conn_id);
+    if (client == nullptr)
+        return ESP_FAIL;
+
+    Peer *peer = client->peer();
+    peer->requests++;
+    uint8_t value[Peer::MAX_VALUE];
+    uint16_t value_len = 0;
+    esp_ble_gattc_cb_param_t param{};
+    param.read.status = peer->read(handle, value, &value_len);
+    param.read.conn_id = conn_id;
+    param.read.handle = handle;
+    if (response_lost(peer))
+        return ESP_OK;
+    esphome::host::queue_event(client, peer->response_latency, ESP_GATTC_READ_CHAR_EVT, param, value, param.read.status == ESP_GATT_OK ? value_len : 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gattc_read_multiple(esp_gatt_if_t gattc_if, uint16_t conn_id, esp_gattc_multi_t *read_multi, esp_gatt_auth_req_t auth_req)
+{
+    BLEClient *client = connected_client(gattc_if, conn_id);
+    if (client == nullptr || read_multi->num_attr > ESP_GATT_MAX_READ_MULTI_HANDLES)
+        return ESP_FAIL;
+
+    Peer *peer = client->peer();
+    peer->requests++;
+    esp_ble_gattc_cb_param_t param{};
+    param.read.conn_id = conn_id;
+    param.read.status = peer->read_multiple_supported ? ESP_GATT_OK : ESP_GATT_REQ_NOT_SUPPORTED;
+
+    // values are concatenated, the response is truncated to ATT_MTU - 1 bytes
+    uint8_t values[Peer::MAX_VALUE * ESP_GATT_MAX_READ_MULTI_HANDLES];
+    uint16_t length = 0;
+    for (uint8_t i = 0; i < read_multi->num_attr && param.read.status == ESP_GATT_OK; i++)
+    {
+        uint16_t value_len = 0;
+        param.read.status = peer->read(read_multi->handles[i], values + length, &value_len);
+        length += value_len;
+    }
+    if (length > peer->mtu - 1)
+        length = peer->mtu - 1;
+
+    if (response_lost(peer))
+        return ESP_OK;
+    esphome::host::queue_event(client, peer->response_latency, ESP_GATTC_READ_MULTIPLE_EVT, param, values, param.read.status == ESP_GATT_OK ? length : 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gattc_write_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle, uint16_t value_len, uint8_t *value,
+                                   esp_gatt_write_type_t write_type, esp_gatt_auth_req_t auth_req)
+{
+    BLEClient *client = connected_client(gattc_if, conn_id);
+    if (client == nullptr)
+        return ESP_FAIL;
+
+    Peer *peer = client->peer();
+    peer->requests++;
+    esp_ble_gattc_cb_param_t param{};
+    param.write.status = peer->write(handle, value, value_len);
+    param.write.conn_id = conn_id;
+    param.write.handle = handle;
+    if (response_lost(peer))
+        return ESP_OK;
+    esphome::host::queue_event(client, peer->response_latency, ESP_GATTC_WRITE_CHAR_EVT, param);
+    return ESP_OK;
+}
+
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params)
+{
+    BLEClient *client = esphome::host::find_client(params->bda);
+    if (client == nullptr || !client->is_connected())
+        return ESP_FAIL;
+
+    // peer accepts the fastest interval of the range
+    esp_ble_gap_cb_param_t param{};
+    param.update_conn_params.status = ESP_BT_STATUS_SUCCESS;
+    memcpy(param.update_conn_params.bda, params->bda, ESP_BD_ADDR_LEN);
+    param.update_conn_params.min_int = params->min_int;
+    param.update_conn_params.max_int = params->max_int;
+    param.update_conn_params.conn_int = params->min_int;
+    param.update_conn_params.latency = params->latency;
+    param.update_conn_params.timeout = params->timeout;
+    esphome::host::queue_event(client, client->peer()->response_latency, ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, param);
+    return ESP_OK;
+}
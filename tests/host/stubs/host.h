@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esphome/components/ble_client/ble_client.h"
+#include "esphome/core/component.h"
+
+// Host side of the stubs: simulated clock, main loop, radio and flash.
+// Nothing here allocates once the components are registered, so the component's own heap traffic can be measured.
+namespace esphome
+{
+    namespace host
+    {
+        using esp32_ble_tracker::ESPBTUUID;
+
+        // GATT server on the other end of a BLEClient, requests are answered after response_latency
+        class Peer
+        {
+        public:
+            static constexpr uint16_t MAX_VALUE = 32;
+
+            virtual ~Peer() = default;
+
+            // handle of the characteristic, 0 if there is none
+            virtual uint16_t find_characteristic(const ESPBTUUID &service, const ESPBTUUID &characteristic) = 0;
+            // value has room for MAX_VALUE bytes
+            virtual esp_gatt_status_t read(uint16_t handle, uint8_t *value, uint16_t *value_len) = 0;
+            virtual esp_gatt_status_t write(uint16_t handle, const uint8_t *value, uint16_t value_len) = 0;
+            virtual void on_connect() {}
+            virtual void on_disconnect() {}
+
+            // link timings, ms
+            uint32_t connect_latency{600};
+            uint32_t discovery_latency{1200};
+            uint32_t response_latency{60};
+            uint32_t disconnect_latency{40};
+            uint32_t open_failure_latency{5000}; // peer out of range: ESP_GATTC_OPEN_EVT reports the failure after that
+            uint32_t advertising_interval{2000};
+            int rssi{-70};
+            uint16_t mtu{ESP_GATT_DEF_BLE_MTU_SIZE};
+            bool read_multiple_supported{true};
+            bool in_range{true}; // advertises and accepts connections
+            bool accepts_connections{true}; // advertises, but refuses to connect, i.e. serves another central
+            uint32_t lost_responses{0};     // requests are processed, but responses to this many of them never arrive
+
+            // connections opened by the central, successful or not
+            uint32_t connection_attempts{0};
+            uint32_t connections{0};
+            uint32_t requests{0}; // ATT requests, a read multiple counts once
+        };
+
+        static constexpr uint8_t MAX_CLIENTS = 16;
+
+        // ms between two loop() calls, as in the firmware
+        static constexpr uint32_t LOOP_INTERVAL = 16;
+
+        void set_log_level(int level);
+
+        // components are set up in the order of their priority, then run by step() till reset()
+        void register_component(Component *component);
+        void setup();
+        // delivers due radio events, runs loop() of every component and update() of the due pollers, advances the clock
+        void step();
+        void run_for(uint32_t ms);
+        template <typename F>
+        bool run_until(F condition, uint32_t timeout)
+        {
+            uint32_t deadline = millis() + timeout;
+            while (!condition())
+            {
+                if ((int32_t)(millis() - deadline) >= 0)
+                    return false;
+                step();
+            }
+            return true;
+        }
+        // forgets the components and the radio events, clock and flash are kept
+        void reset();
+
+        // flash
+        void reset_preferences();
+        uint32_t preference_writes(); // save() calls since the last reset_preferences()
+
+        // radio, used by the BLEClient stub
+        void queue_event(ble_client::BLEClient *client, uint32_t delay, esp_gattc_cb_event_t event, const esp_ble_gattc_cb_param_t &param,
+                         const uint8_t *value = nullptr, uint16_t value_len = 0);
+        void queue_event(ble_client::BLEClient *client, uint32_t delay, esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t &param);
+        // responses, which are not delivered yet, are lost with the link
+        void drop_events(ble_client::BLEClient *client);
+        ble_client::BLEClient *find_client(uint16_t conn_id);
+        ble_client::BLEClient *find_client(const uint8_t *bda);
+        // clients in the order of registration, their peers are the devices on the air
+        uint8_t client_count();
+        ble_client::BLEClient *client(uint8_t index);
+
+        void set_timezone_offset(int32_t offset);
+    } // namespace host
+} // namespace esphome
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+// Minimal test runner: every TEST() starts with a fresh host (no components, empty flash).
+namespace test
+{
+    typedef void (*TestFunction)();
+
+    struct Register
+    {
+        Register(const char *name, TestFunction function);
+    };
+
+    void fail(const char *file, int line, const char *expression);
+    void fail(const char *file, int line, const char *expression, double actual, double expected);
+} // namespace test
+
+#define TEST(name)                                      \
+    static void name();                                 \
+    static test::Register name##_registration(#name, name); \
+    static void name()
+
+#define CHECK(condition)                                     \
+    do                                                       \
+    {                                                        \
+        if (!(condition))                                    \
+            test::fail(__FILE__, __LINE__, #condition);      \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                                  \
+    do                                                                                              \
+    {                                                                                               \
+        auto actual_ = (actual);                                                                    \
+        auto expected_ = (expected);                                                                \
+        if (!(actual_ == expected_))                                                                \
+            test::fail(__FILE__, __LINE__, #actual " == " #expected, (double)actual_, (double)expected_); \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                                                      \
+    do                                                                                                               \
+    {                                                                                                                \
+        double actual_ = (actual);                                                                                   \
+        double expected_ = (expected);                                                                               \
+        if (std::isnan(actual_) || std::fabs(actual_ - expected_) > (tolerance))                                     \
+            test::fail(__FILE__, __LINE__, #actual " ~= " #expected, actual_, expected_);                            \
+    } while (0)
@@ -0,0 +1,31 @@
+#include "test.h"
+#include "testbed.h"
+#include "alloc_counter.h"
+
+using namespace esphome;
+using namespace esphome::danfoss_eco;
+using namespace esphome::host;
+
+TEST(poll_cycles_do_not_allocate)
+{
+    Testbed bed;
+    bed.scheduler.set_max_connections(1);
+    Radiator *first = bed.add("living_room");
+    Radiator *second = bed.add("kitchen");
+    sensor::Sensor *first_cycles = first->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    sensor::Sensor *second_cycles = second->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    bed.setup();
+
+    // the first cycle resolves the handles, the following ones run from the cache
+    uint32_t interval = first->device.get_update_interval();
+    CHECK(run_until([&]
+                    { return first_cycles->state >= 2 && second_cycles->state >= 2; },
+                    3 * interval));
+
+    uint64_t before = allocations();
+    CHECK(before > 0); // setup allocates, so the counter is hooked up
+    float polled = first_cycles->state + second_cycles->state;
+    run_for(10 * interval);
+    CHECK_EQ(first_cycles->state + second_cycles->state - polled, 20);
+    CHECK_EQ(allocations() - before, 0u);
+}
@@ -0,0 +1,212 @@
+#include "test.h"
+#include "testbed.h"
+
+using namespace esphome;
+using namespace esphome::danfoss_eco;
+using namespace esphome::host;
+
+static void set_mode(Radiator *r, climate::ClimateMode mode)
+{
+    climate::ClimateCall call(&r->device);
+    call.set_mode(mode);
+    call.perform();
+}
+
+static void set_target_temperature(Radiator *r, float temperature)
+{
+    climate::ClimateCall call(&r->device);
+    call.set_target_temperature(temperature);
+    call.perform();
+}
+
+// polls the device once, so its state is saved to flash, and reboots the host (flash is kept)
+static void boot_once()
+{
+    {
+        Testbed bed;
+        Radiator *r = bed.add("living_room");
+        sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+        bed.setup();
+        CHECK(run_until([&]
+                        { return cycles->state >= 1; },
+                        30000));
+    }
+    reset();
+}
+
+TEST(mode_change_over_the_restored_state_keeps_the_device_settings)
+{
+    boot_once();
+
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    r->peer.settings[2] = 50; // max temperature was set to 25°C on the device, after the state was saved
+    bed.setup();
+
+    // user changes the mode right after the boot, while the state is the one restored from flash
+    set_mode(r, climate::CLIMATE_MODE_AUTO);
+    CHECK(run_until([&]
+                    { return r->peer.settings_writes > 0; },
+                    30000));
+    CHECK_EQ(r->peer.settings_writes, 1u);
+    CHECK_EQ(r->peer.settings[2], 50);
+    CHECK_EQ(r->peer.settings[4], 1); // scheduled
+    CHECK_EQ(r->device.mode, climate::CLIMATE_MODE_AUTO);
+}
+
+TEST(group_result_waits_for_every_write_of_the_device)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    int results = 0, failures = 0;
+    bed.scheduler.add_on_group_result_callback([&](std::string name, bool success)
+                                               {
+                                                   results++;
+                                                   failures += success ? 0 : 1;
+                                               });
+    bed.setup();
+    CHECK(run_until([&]
+                    { return cycles->state >= 1; },
+                    30000));
+
+    // mode is written first and acknowledged, the setpoint is rejected
+    r->peer.fail_next_write(FakeEtrv::TEMPERATURE, ESP_GATT_ERROR);
+    GroupCommand command;
+    command.mode = climate::CLIMATE_MODE_AUTO;
+    command.target_temperature = 17.0f;
+    bed.scheduler.start_group({}, command);
+    CHECK(run_until([&]
+                    { return cycles->state >= 2; },
+                    30000));
+    CHECK_EQ(r->peer.settings_writes, 1u);
+    CHECK_EQ(r->peer.temperature_writes, 0u);
+    CHECK_EQ(results, 1);
+    CHECK_EQ(failures, 1);
+}
+
+TEST(control_while_the_link_is_closing_waits_for_the_close)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    bed.setup();
+
+    // poll is done and its link is being closed
+    CHECK(run_until([&]
+                    { return r->client.state() == ble_client::ClientState::DISCONNECTING; },
+                    30000));
+    set_target_temperature(r, 17.0f);
+
+    CHECK(run_until([&]
+                    { return r->peer.temperature_writes > 0; },
+                    30000));
+    CHECK_EQ(r->peer.target_half_degrees, 34);
+    CHECK(run_until([&]
+                    { return cycles->state >= 2; },
+                    30000));
+    CHECK_EQ(r->peer.connections, 2u);
+}
+
+TEST(control_during_the_reads_of_a_poll_keeps_the_desired_setpoint)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    r->device.set_temperature_verification(WriteVerification::NONE);
+    bed.setup();
+    CHECK(run_until([&]
+                    { return cycles->state >= 1; },
+                    30000));
+
+    // PIN of the next poll is accepted and its reads are sent, their responses carry the old setpoint
+    uint32_t requests = r->peer.requests;
+    r->peer.response_latency = 500;
+    CHECK(run_until([&]
+                    { return r->peer.requests >= requests + 3; },
+                    180000));
+    set_target_temperature(r, 17.0f);
+
+    CHECK(run_until([&]
+                    { return cycles->state >= 2; },
+                    30000));
+    CHECK_EQ(r->peer.temperature_writes, 1u);
+    CHECK_EQ(r->peer.target_half_degrees, 34);
+    CHECK_EQ(r->device.target_temperature, 17.0f);
+}
+
+TEST(setpoint_changes_within_the_debounce_window_are_written_once)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    r->device.set_write_debounce(2000);
+    bed.setup();
+    CHECK(run_until([&]
+                    { return cycles->state >= 1; },
+                    30000));
+
+    // user drags the setpoint slider, the connection is being opened meanwhile
+    set_target_temperature(r, 17.0f);
+    run_for(500);
+    set_target_temperature(r, 17.5f);
+    run_for(500);
+    set_target_temperature(r, 18.0f);
+    CHECK_EQ(r->peer.temperature_writes, 0u);
+
+    CHECK(run_until([&]
+                    { return cycles->state >= 2; },
+                    30000));
+    CHECK_EQ(r->peer.temperature_writes, 1u);
+    CHECK_EQ(r->peer.target_half_degrees, 36);
+    CHECK_EQ(r->device.target_temperature, 18.0f);
+}
+
+TEST(polls_write_the_state_to_flash_only_when_the_setpoint_or_settings_change)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    bed.setup();
+    CHECK(run_until([&]
+                    { return cycles->state >= 1; },
+                    30000));
+
+    // room is warming up, nothing else changes
+    uint32_t writes = preference_writes();
+    for (int cycle = 2; cycle <= 4; cycle++)
+    {
+        r->peer.room_half_degrees++;
+        CHECK(run_until([&]
+                        { return cycles->state >= cycle; },
+                        180000));
+    }
+    CHECK_EQ(preference_writes(), writes);
+
+    // setpoint was changed on the device itself
+    r->peer.target_half_degrees = 44;
+    CHECK(run_until([&]
+                    { return cycles->state >= 5; },
+                    180000));
+    CHECK_EQ(preference_writes(), writes + 1);
+}
+
+TEST(stale_sensor_is_on_till_the_restored_state_is_read_from_the_device)
+{
+    boot_once();
+
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    binary_sensor::BinarySensor stale;
+    r->device.set_stale(&stale);
+    bed.setup();
+    CHECK(stale.state);
+    CHECK_EQ(r->device.target_temperature, 21.0f);
+
+    CHECK(run_until([&]
+                    { return cycles->state >= 1; },
+                    30000));
+    CHECK(!stale.state);
+    CHECK_EQ(stale.publish_count, 2u);
+}
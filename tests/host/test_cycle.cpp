@@ -0,0 +1,132 @@
+#include "test.h"
+#include "testbed.h"
+
+using namespace esphome;
+using namespace esphome::danfoss_eco;
+using namespace esphome::host;
+
+TEST(poll_cycle_reads_state_and_times_every_phase)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *connect = r->latency(LatencyMetric::CONNECT, LatencyStat::MAX);
+    sensor::Sensor *discovery = r->latency(LatencyMetric::DISCOVERY, LatencyStat::MAX);
+    sensor::Sensor *disconnect = r->latency(LatencyMetric::DISCONNECT, LatencyStat::MAX);
+    bed.setup();
+
+    CHECK(run_until([&]
+                    { return disconnect->publish_count > 0; },
+                    30000));
+    CHECK_EQ(r->peer.connections, 1u);
+    CHECK_NEAR(connect->state, r->peer.connect_latency, 2 * LOOP_INTERVAL);
+    CHECK_NEAR(discovery->state, r->peer.discovery_latency, 2 * LOOP_INTERVAL);
+    CHECK_NEAR(disconnect->state, r->peer.disconnect_latency, 2 * LOOP_INTERVAL);
+    CHECK_NEAR(r->device.target_temperature, 21.0, 0.01);
+    CHECK_NEAR(r->device.current_temperature, 19.5, 0.01);
+    CHECK_EQ(r->device.mode, climate::CLIMATE_MODE_HEAT);
+    CHECK(r->client.state() == ble_client::ClientState::IDLE);
+}
+
+TEST(cached_handles_skip_the_discovery_wait)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *discovery = r->latency(LatencyMetric::DISCOVERY, LatencyStat::P50);
+    sensor::Sensor *disconnect = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    bed.setup();
+
+    CHECK(run_until([&]
+                    { return disconnect->state >= 2; },
+                    r->device.get_update_interval() + 30000));
+    // first cycle waits for the service discovery, the second one writes the PIN right after the link is open
+    CHECK_EQ(r->peer.connections, 2u);
+    CHECK(discovery->state < r->peer.discovery_latency);
+}
+
+TEST(failed_open_does_not_count_into_the_next_connect_phase)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *connect = r->latency(LatencyMetric::CONNECT, LatencyStat::MAX);
+    sensor::Sensor *failures = r->latency(LatencyMetric::CONNECT, LatencyStat::FAILURES);
+    r->peer.in_range = false;
+    bed.setup();
+
+    run_for(r->peer.open_failure_latency + 100);
+    CHECK_EQ(r->peer.connection_attempts, 1u);
+
+    r->peer.in_range = true;
+    CHECK(run_until([&]
+                    { return connect->publish_count > 0; },
+                    5 * 60000));
+    CHECK_EQ(failures->state, 1);
+    // backoff after the failed attempt is not a part of the successful connection
+    CHECK_NEAR(connect->state, r->peer.connect_latency, 2 * LOOP_INTERVAL);
+}
+
+TEST(wrong_pin_keeps_the_cached_handles)
+{
+    // polls are spread by the device phase, so the next one is due within two update intervals
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *pin_failures = r->latency(LatencyMetric::PIN, LatencyStat::FAILURES);
+    sensor::Sensor *discovery = r->latency(LatencyMetric::DISCOVERY, LatencyStat::P50);
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    bed.setup();
+
+    CHECK(run_until([&]
+                    { return cycles->state >= 1; },
+                    30000));
+
+    r->peer.pin_code = 9999;
+    uint32_t writes = preference_writes();
+    CHECK(run_until([&]
+                    { return pin_failures->state >= 1; },
+                    2 * r->device.get_update_interval()));
+    run_for(1000);
+    // handles are fine, wrong PIN costs no flash writes
+    CHECK_EQ(preference_writes(), writes);
+
+    r->peer.pin_code = PIN_CODE;
+    CHECK(run_until([&]
+                    { return cycles->state >= 3; },
+                    5 * 60000));
+    CHECK(discovery->state < r->peer.discovery_latency);
+}
+
+TEST(outdated_cached_handle_falls_back_to_the_discovery)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *pin_failures = r->latency(LatencyMetric::PIN, LatencyStat::FAILURES);
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    bed.setup();
+
+    CHECK(run_until([&]
+                    { return cycles->state >= 1; },
+                    30000));
+
+    r->peer.fail_next_write(FakeEtrv::PIN, ESP_GATT_INVALID_HANDLE);
+    CHECK(run_until([&]
+                    { return cycles->state >= 2; },
+                    2 * r->device.get_update_interval()));
+    // PIN is written again with the discovered handles over the same connection
+    CHECK_EQ(r->peer.connections, 2u);
+    CHECK_EQ(pin_failures->state, 0);
+}
+
+TEST(poll_reads_are_packed_into_two_requests)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    bed.setup();
+
+    CHECK(run_until([&]
+                    { return cycles->state >= 1; },
+                    30000));
+    // PIN, then settings+battery (17 bytes) and temperature+errors (16 bytes) fit into the default MTU
+    CHECK_EQ(r->peer.requests, 3u);
+    CHECK_NEAR(r->device.current_temperature, 19.5, 0.01);
+    CHECK_EQ(r->device.mode, climate::CLIMATE_MODE_HEAT);
+}
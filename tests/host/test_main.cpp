@@ -0,0 +1,62 @@
+#include "test.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "host.h"
+
+namespace test
+{
+    struct Case
+    {
+        const char *name;
+        TestFunction function;
+    };
+
+    static std::vector<Case> &cases()
+    {
+        static std::vector<Case> cases;
+        return cases;
+    }
+
+    static int failures = 0;
+
+    Register::Register(const char *name, TestFunction function) { cases().push_back(Case{name, function}); }
+
+    void fail(const char *file, int line, const char *expression)
+    {
+        printf("%s:%d: FAILED: %s\n", file, line, expression);
+        failures++;
+    }
+
+    void fail(const char *file, int line, const char *expression, double actual, double expected)
+    {
+        printf("%s:%d: FAILED: %s (actual %g, expected %g)\n", file, line, expression, actual, expected);
+        failures++;
+    }
+} // namespace test
+
+// usage: <test> [name], DANFOSS_ECO_LOG=5 shows the component's debug log
+int main(int argc, char **argv)
+{
+    const char *level = getenv("DANFOSS_ECO_LOG");
+    int passed = 0, failed = 0;
+    for (auto &c : test::cases())
+    {
+        if (argc > 1 && strcmp(argv[1], c.name) != 0)
+            continue;
+
+        esphome::host::reset();
+        esphome::host::reset_preferences();
+        esphome::host::set_log_level(level != nullptr ? atoi(level) : ESPHOME_LOG_LEVEL_NONE);
+
+        int before = test::failures;
+        c.function();
+        bool ok = test::failures == before;
+        printf("[%s] %s\n", ok ? "  OK  " : "FAILED", c.name);
+        (ok ? passed : failed)++;
+    }
+    printf("%d passed, %d failed\n", passed, failed);
+    return failed == 0 && passed > 0 ? 0 : 1;
+}
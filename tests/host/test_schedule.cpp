@@ -0,0 +1,48 @@
+#include "test.h"
+#include "testbed.h"
+
+using namespace esphome;
+using namespace esphome::danfoss_eco;
+using namespace esphome::host;
+
+// monday 06:00 - 08:30, tuesday without periods (the eTRV has no periods on any day)
+static void configure_schedule(Radiator *r)
+{
+    r->device.add_schedule_day(0);
+    r->device.add_schedule_period(0, 12, 17);
+    r->device.add_schedule_day(1);
+}
+
+TEST(schedule_is_only_compared_without_write_schedule)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    configure_schedule(r);
+    bed.setup();
+
+    CHECK(run_until([&]
+                    { return cycles->state >= 2; },
+                    3 * r->device.get_update_interval()));
+    CHECK_EQ(r->peer.schedule_writes, 0u);
+    CHECK_EQ(r->peer.schedule[0][0], ScheduleDayData::UNUSED);
+}
+
+TEST(only_the_days_differing_on_the_device_are_written)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    configure_schedule(r);
+    r->device.set_write_schedule(true);
+    bed.setup();
+
+    CHECK(run_until([&]
+                    { return cycles->state >= 2; },
+                    3 * r->device.get_update_interval()));
+    // tuesday is empty on the device already, days confirmed in the first session are not checked again
+    CHECK_EQ(r->peer.schedule_writes, 1u);
+    CHECK_EQ(r->peer.schedule[0][0], 12);
+    CHECK_EQ(r->peer.schedule[0][1], 17);
+    CHECK_EQ(r->peer.schedule[0][2], ScheduleDayData::UNUSED);
+}
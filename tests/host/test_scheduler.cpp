@@ -0,0 +1,294 @@
+#include "test.h"
+#include "testbed.h"
+
+using namespace esphome;
+using namespace esphome::danfoss_eco;
+using namespace esphome::host;
+
+TEST(failed_open_hands_the_slot_to_the_next_device)
+{
+    Testbed bed;
+    bed.scheduler.set_max_connections(1);
+    Radiator *away = bed.add("away");
+    Radiator *kitchen = bed.add("kitchen");
+    away->peer.accepts_connections = false;
+    away->peer.rssi = -40; // closer one is granted first
+    bed.setup();
+
+    CHECK(run_until([&]
+                    { return kitchen->peer.connections > 0; },
+                    30000));
+    CHECK_EQ(away->peer.connection_attempts, 1u);
+    // granted right after the failure is reported, not after connection_timeout
+    CHECK(millis() < 1000 + away->peer.open_failure_latency + 1000);
+    CHECK(!away->client.enabled);
+}
+
+TEST(ble_client_does_not_connect_outside_the_scheduler)
+{
+    Testbed bed;
+    bed.scheduler.set_max_connections(1);
+    Radiator *first = bed.add("living_room");
+    Radiator *second = bed.add("kitchen"); // waits for the slot at boot
+    sensor::Sensor *first_cycles = first->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    sensor::Sensor *second_cycles = second->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    bed.setup();
+
+    run_for(10 * 60000 + 30000);
+    CHECK_EQ(first_cycles->state, 11);
+    CHECK_EQ(second_cycles->state, 11);
+    // every connection was a scheduled poll
+    CHECK_EQ(first->peer.connection_attempts, 11u);
+    CHECK_EQ(second->peer.connection_attempts, 11u);
+    CHECK(!first->client.enabled);
+    CHECK(!second->client.enabled);
+}
+
+TEST(dropped_link_releases_the_slot)
+{
+    Testbed bed;
+    bed.scheduler.set_max_connections(1);
+    Radiator *flaky = bed.add("flaky");
+    Radiator *kitchen = bed.add("kitchen");
+    flaky->peer.response_latency = 20000; // session is kept open, waiting for the responses
+    bed.setup();
+
+    CHECK(run_until([&]
+                    { return flaky->device.is_established(); },
+                    30000));
+    CHECK_EQ(kitchen->peer.connection_attempts, 0u);
+
+    uint32_t dropped_at = millis();
+    flaky->client.drop_link();
+    CHECK(run_until([&]
+                    { return kitchen->peer.connections > 0; },
+                    30000));
+    CHECK(millis() - dropped_at < 2 * kitchen->peer.connect_latency);
+    CHECK(!flaky->client.enabled);
+    CHECK_EQ(flaky->peer.connection_attempts, 1u);
+}
+
+// returns the time the next connection attempt of the radiator was started at
+static uint32_t next_attempt(Radiator *r, uint32_t timeout)
+{
+    uint32_t attempts = r->peer.connection_attempts;
+    CHECK(run_until([&]
+                    { return r->peer.connection_attempts > attempts; },
+                    timeout));
+    return millis();
+}
+
+TEST(circuit_breaker_backs_off_opens_and_probes)
+{
+    Testbed bed;
+    Radiator *r = bed.add("away");
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    text_sensor::TextSensor breaker;
+    r->device.set_breaker_state(&breaker);
+    r->device.set_update_interval(1000); // polls are due all the time, attempts are paced by the breaker only
+    r->device.set_circuit_breaker(3, 10000, 60000);
+    r->peer.accepts_connections = false;
+    bed.setup();
+
+    // failures below the threshold are retried with exponential backoff (+-25% jitter), each attempt fails after open_failure_latency
+    uint32_t failure = r->peer.open_failure_latency;
+    uint32_t first = next_attempt(r, 5000);
+    uint32_t second = next_attempt(r, 60000);
+    CHECK(second - first >= failure + 7500 && second - first <= failure + 12500 + 2000);
+    uint32_t third = next_attempt(r, 60000);
+    CHECK(third - second >= failure + 15000 && third - second <= failure + 25000 + 2000);
+    CHECK(breaker.state == "closed");
+
+    // third failure opens the breaker for max_backoff
+    CHECK(run_until([&]
+                    { return breaker.state == "open"; },
+                    10000));
+    uint32_t opened = millis();
+    uint32_t probe = next_attempt(r, 120000);
+    CHECK(probe - opened >= 45000 && probe - opened <= 75000 + 2000);
+    CHECK(breaker.state == "half_open");
+
+    // failed probe re-opens the breaker right away
+    CHECK(run_until([&]
+                    { return breaker.state == "open"; },
+                    10000));
+    CHECK_EQ(r->peer.connection_attempts, 4u);
+
+    // successful probe closes it, the device is polled as usual
+    r->peer.accepts_connections = true;
+    next_attempt(r, 120000);
+    CHECK(breaker.state == "half_open");
+    CHECK(run_until([&]
+                    { return cycles->state >= 1; },
+                    30000));
+    CHECK(breaker.state == "closed");
+    CHECK(r->device.may_connect(millis()));
+}
+
+TEST(breaker_is_half_open_only_while_its_probe_is_made)
+{
+    Testbed bed;
+    bed.scheduler.set_max_connections(1);
+    Radiator *away = bed.add("away");
+    Radiator *kitchen = bed.add("kitchen");
+    Radiator *hall = bed.add("hall");
+    text_sensor::TextSensor breaker;
+    away->device.set_breaker_state(&breaker);
+    away->device.set_update_interval(1000);
+    away->device.set_circuit_breaker(1, 5000, 5000);
+    away->peer.accepts_connections = false;
+    away->peer.rssi = -40;
+    kitchen->peer.rssi = -50;
+    kitchen->peer.response_latency = 3000; // open period of the breaker is over, while kitchen holds the slot
+    hall->peer.rssi = -60;
+    bed.setup();
+
+    // away is granted first and fails, kitchen is next
+    CHECK(run_until([&]
+                    { return breaker.state == "open"; },
+                    30000));
+    away->peer.rssi = -90;
+    CHECK(run_until([&]
+                    { return kitchen->device.is_established(); },
+                    30000));
+
+    // hall is granted after kitchen, the probe of away waits for the slot
+    CHECK(!run_until([&]
+                     { return breaker.state == "half_open" && !away->client.enabled; },
+                     60000));
+    CHECK_EQ(hall->peer.connections, 1u);
+    CHECK(away->peer.connection_attempts > 1);
+}
+
+TEST(wrong_pin_is_retried_without_a_reboot)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *pin_failures = r->latency(LatencyMetric::PIN, LatencyStat::FAILURES);
+    sensor::Sensor *pin_successes = r->latency(LatencyMetric::PIN, LatencyStat::SUCCESSES);
+    r->peer.pin_code = 4321;
+    bed.setup();
+
+    CHECK(run_until([&]
+                    { return pin_failures->state >= 2; },
+                    300000));
+    CHECK_EQ(pin_successes->state, 0);
+
+    // user fixes the PIN on the device (or in the config), the next poll succeeds
+    r->peer.pin_code = PIN_CODE;
+    CHECK(run_until([&]
+                    { return pin_successes->state >= 1; },
+                    300000));
+    CHECK_EQ(r->device.target_temperature, 21.0f);
+}
+
+TEST(lost_response_is_retried_after_the_request_timeout)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    sensor::Sensor timeouts;
+    sensor::Sensor battery;
+    r->device.set_request_timeouts(&timeouts);
+    r->device.set_battery_level(&battery);
+    r->device.set_request_timeout(2000, 1);
+    r->device.set_update_interval(600000); // next poll is not due during the session
+    r->peer.read_multiple_supported = false; // single reads are matched by handle
+    bed.setup();
+    CHECK(run_until([&]
+                    { return cycles->state >= 1; },
+                    30000));
+
+    // PIN of the next poll is written, the response to the first read, which follows it, is lost
+    uint32_t requests = r->peer.requests;
+    CHECK(run_until([&]
+                    { return r->peer.requests > requests; },
+                    2 * 600000));
+    r->peer.lost_responses = 1;
+    uint32_t pin_at = millis();
+    r->peer.target_half_degrees = 44;
+    CHECK(run_until([&]
+                    { return cycles->state >= 2; },
+                    30000));
+    CHECK_EQ(timeouts.state, 1);
+    CHECK(millis() - pin_at >= 2000);
+    // PIN, battery, temperature, settings, errors and the retried read
+    CHECK_EQ(r->peer.requests, requests + 6);
+    CHECK_EQ(battery.publish_count, 2u); // lost battery read was answered the second time
+    CHECK_EQ(r->device.target_temperature, 22.0f);
+}
+
+TEST(device_which_stops_responding_releases_the_slot_after_the_retries)
+{
+    Testbed bed;
+    bed.scheduler.set_max_connections(1);
+    Radiator *mute = bed.add("mute");
+    Radiator *kitchen = bed.add("kitchen");
+    mute->peer.rssi = -40; // granted first
+    sensor::Sensor timeouts;
+    mute->device.set_request_timeouts(&timeouts);
+    mute->device.set_request_timeout(2000, 2);
+    bed.setup();
+
+    CHECK(run_until([&]
+                    { return mute->peer.requests > 0; },
+                    30000));
+    mute->peer.lost_responses = UINT32_MAX;
+    CHECK(run_until([&]
+                    { return mute->device.is_established(); },
+                    30000));
+    uint32_t established_at = millis();
+    CHECK(run_until([&]
+                    { return kitchen->peer.connections > 0; },
+                    30000));
+    // both read multiple batches are sent 3 times, then the session is closed, well before connection_timeout
+    CHECK_EQ(timeouts.state, 6);
+    CHECK(millis() - established_at >= 3 * 2000);
+    CHECK(millis() - established_at < 3 * 2000 + 2000);
+    CHECK(!mute->client.enabled);
+}
+
+TEST(adaptive_polling_backs_off_while_idle_and_speeds_up_while_heating)
+{
+    Testbed bed;
+    Radiator *r = bed.add("living_room");
+    sensor::Sensor *cycles = r->latency(LatencyMetric::DISCONNECT, LatencyStat::SUCCESSES);
+    sensor::Sensor effective;
+    r->device.set_effective_interval(&effective);
+    r->device.set_adaptive_polling(30000, 240000);
+    bed.setup();
+
+    // returns the time the given cycle has completed at
+    auto cycle = [&](int n)
+    {
+        CHECK(run_until([&]
+                        { return cycles->state >= n; },
+                        2 * 240000));
+        return millis();
+    };
+
+    // nothing changes: the interval doubles with every poll, up to max_interval
+    cycle(1);
+    cycle(2);
+    CHECK_EQ(effective.state, 120);
+    cycle(3);
+    CHECK_EQ(effective.state, 240);
+    uint32_t publishes = effective.publish_count;
+    uint32_t fourth = cycle(4);
+    uint32_t fifth = cycle(5);
+    CHECK_EQ(effective.state, 240);
+    CHECK_EQ(effective.publish_count, publishes);
+    // first poll after the change is aligned to the phase of the device, the next ones are one interval apart
+    CHECK(fifth - fourth >= 240000 - 1000 && fifth - fourth <= 240000 + 1000);
+
+    // room is warming up towards the target: back to min_interval right away
+    r->peer.room_half_degrees++;
+    cycle(6);
+    CHECK_EQ(effective.state, 30);
+    r->peer.room_half_degrees++;
+    uint32_t seventh = cycle(7);
+    r->peer.room_half_degrees++;
+    uint32_t eighth = cycle(8);
+    CHECK_EQ(effective.state, 30);
+    CHECK(eighth - seventh >= 30000 - 1000 && eighth - seventh <= 30000 + 1000);
+}
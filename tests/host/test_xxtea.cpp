@@ -0,0 +1,81 @@
+#include "test.h"
+
+#include <cstring>
+#include <initializer_list>
+
+#include "helpers.h"
+
+using namespace esphome::danfoss_eco;
+
+// Known answers of the reference XXTEA (corrected block TEA, Wheeler & Needham) with the key 00112233..eeff,
+// plain text 00 01 02 .. in the eTRV byte order (every 32-bit word is big-endian on the wire).
+static const uint8_t KEY[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+static const uint8_t CIPHER_8[8] = {0x1f, 0xe1, 0x3d, 0x82, 0x65, 0x9e, 0x53, 0x7c};
+static const uint8_t CIPHER_12[12] = {0x30, 0x6c, 0xe0, 0x74, 0xc3, 0xae, 0x55, 0x14, 0x56, 0x3d, 0x13, 0x18};
+static const uint8_t CIPHER_16[16] = {0xc9, 0x99, 0xcb, 0xfe, 0x82, 0x6c, 0xf8, 0x2a, 0x38, 0xd2, 0x33, 0x9f, 0xcf, 0xbf, 0x69, 0x0f};
+
+static void check_known_answer(const uint8_t *cipher, uint16_t len)
+{
+    Xxtea xxtea;
+    xxtea.set_key(KEY, sizeof(KEY));
+
+    uint8_t plain[MAX_ENCRYPTED_LENGTH];
+    for (uint16_t i = 0; i < len; i++)
+        plain[i] = i;
+
+    uint8_t value[MAX_ENCRYPTED_LENGTH];
+    memcpy(value, plain, len);
+    encrypt(xxtea, value, len);
+    CHECK(memcmp(value, cipher, len) == 0);
+
+    uint8_t decrypted[MAX_ENCRYPTED_LENGTH];
+    decrypt(xxtea, cipher, len, decrypted);
+    CHECK(memcmp(decrypted, plain, len) == 0);
+}
+
+TEST(two_word_fast_path_matches_the_known_answer) { check_known_answer(CIPHER_8, sizeof(CIPHER_8)); }
+
+TEST(four_word_fast_path_matches_the_known_answer) { check_known_answer(CIPHER_16, sizeof(CIPHER_16)); }
+
+TEST(generic_path_matches_the_known_answer) { check_known_answer(CIPHER_12, sizeof(CIPHER_12)); }
+
+TEST(fast_paths_match_the_generic_path)
+{
+    Xxtea xxtea;
+    xxtea.set_key(KEY, sizeof(KEY));
+
+    uint32_t seed = 1;
+    for (int round = 0; round < 1000; round++)
+    {
+        for (uint16_t len : {8, 16})
+        {
+            uint8_t plain[MAX_ENCRYPTED_LENGTH];
+            for (uint16_t i = 0; i < len; i++)
+                plain[i] = (seed = seed * 1103515245 + 12345) >> 16;
+
+            // reference: words are reversed into little-endian, encrypted and reversed back
+            uint8_t expected[MAX_ENCRYPTED_LENGTH], buffer[MAX_ENCRYPTED_LENGTH];
+            reverse_chunks(plain, len, buffer);
+            xxtea.encrypt(buffer, len);
+            reverse_chunks(buffer, len, expected);
+
+            uint8_t value[MAX_ENCRYPTED_LENGTH];
+            memcpy(value, plain, len);
+            encrypt(xxtea, value, len);
+            CHECK(memcmp(value, expected, len) == 0);
+
+            uint8_t decrypted[MAX_ENCRYPTED_LENGTH];
+            decrypt(xxtea, value, len, decrypted);
+            CHECK(memcmp(decrypted, plain, len) == 0);
+        }
+    }
+}
+
+TEST(value_is_left_as_is_without_a_key)
+{
+    Xxtea xxtea;
+    uint8_t value[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t plain[8];
+    decrypt(xxtea, value, sizeof(value), plain);
+    CHECK(memcmp(plain, value, sizeof(value)) == 0);
+}
@@ -0,0 +1,48 @@
+#include "testbed.h"
+
+namespace esphome
+{
+    namespace host
+    {
+        const char *const SECRET_KEY_HEX = "00112233445566778899aabbccddeeff";
+        const uint8_t SECRET_KEY[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+
+        Radiator::Radiator(esp32_ble_tracker::ESP32BLETracker *tracker, danfoss_eco::ConnectionScheduler *scheduler, const char *name, uint64_t mac)
+        {
+            this->client.set_address(mac);
+            this->client.set_peer(&this->peer);
+            register_component(&this->client);
+
+            this->device.set_name(name);
+            register_component(&this->device);
+            this->client.register_ble_node(&this->device);
+            tracker->register_listener(&this->device);
+            scheduler->register_device(&this->device);
+
+            this->device.set_secret_key(SECRET_KEY_HEX);
+            this->device.set_pin_code("1234");
+            this->device.set_update_interval(60000);
+            this->device.set_request_timeout(5000, 1);
+            this->device.set_circuit_breaker(5, 10000, 600000);
+        }
+
+        sensor::Sensor *Radiator::latency(danfoss_eco::LatencyMetric metric, danfoss_eco::LatencyStat stat)
+        {
+            this->sensors.emplace_back(new sensor::Sensor());
+            this->device.set_latency_sensor(metric, stat, this->sensors.back().get());
+            return this->sensors.back().get();
+        }
+
+        Radiator *Testbed::add(const char *name)
+        {
+            if (this->radiators.empty())
+            {
+                register_component(&this->tracker);
+                register_component(&this->scheduler);
+            }
+            uint64_t mac = 0x00042F000000ULL + this->radiators.size() + 1;
+            this->radiators.emplace_back(new Radiator(&this->tracker, &this->scheduler, name, mac));
+            return this->radiators.back().get();
+        }
+    } // namespace host
+} // namespace esphome
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "device.h"
+#include "fake_etrv.h"
+#include "scheduler.h"
+
+namespace esphome
+{
+    namespace host
+    {
+        extern const char *const SECRET_KEY_HEX;
+        extern const uint8_t SECRET_KEY[16];
+        static constexpr uint32_t PIN_CODE = 1234;
+
+        // eTRV wired the same way, as the code generated from the YAML config does it, talking to a simulated peer
+        struct Radiator
+        {
+            Radiator(esp32_ble_tracker::ESP32BLETracker *tracker, danfoss_eco::ConnectionScheduler *scheduler, const char *name, uint64_t mac);
+
+            // published by the device at the end of each cycle
+            sensor::Sensor *latency(danfoss_eco::LatencyMetric metric, danfoss_eco::LatencyStat stat);
+
+            FakeEtrv peer{SECRET_KEY, PIN_CODE};
+            ble_client::BLEClient client;
+            danfoss_eco::Device device;
+            std::vector<std::unique_ptr<sensor::Sensor>> sensors;
+        };
+
+        // hub and radiators, the hub is configured before host::setup()
+        struct Testbed
+        {
+            Radiator *add(const char *name);
+            void setup() { host::setup(); }
+
+            esp32_ble_tracker::ESP32BLETracker tracker;
+            danfoss_eco::ConnectionScheduler scheduler;
+            std::vector<std::unique_ptr<Radiator>> radiators;
+        };
+    } // namespace host
+} // namespace esphome